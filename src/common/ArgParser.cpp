@@ -1,5 +1,6 @@
 // common/ArgParser.cpp
 #include "ArgParser.hpp"
+#include "Exception.hpp"
 #include <iostream>
 #include <algorithm>
 
@@ -24,31 +25,145 @@ static ResNetVersion parseResNetVersion(const std::string& s) {
     return ResNetVersion::R18; // default
 }
 
+// Parse a comma-separated list of image sides ("128,192,256")
+static std::vector<int> parseSizeList(const std::string& s) {
+    std::vector<int> sizes;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(',', start);
+        if (end == std::string::npos) end = s.size();
+        if (end > start) sizes.push_back(std::max(1, std::stoi(s.substr(start, end - start))));
+        start = end + 1;
+    }
+    return sizes;
+}
+
+// Parse tile blending window name
+static TileBlend parseTileBlend(const std::string& s) {
+    std::string low = toLower(s);
+    if (low == "gaussian") return TileBlend::Gaussian;
+    if (low == "linear")   return TileBlend::Linear;
+    std::cerr << "[WARN] Unknown tile blend: " << s << ", using gaussian\n";
+    return TileBlend::Gaussian;
+}
+
+// Parse optimizer name
+static OptimizerType parseOptimizerType(const std::string& s) {
+    std::string low = toLower(s);
+    if (low == "adam")  return OptimizerType::Adam;
+    if (low == "adamw") return OptimizerType::AdamW;
+    if (low == "sgd")   return OptimizerType::SGD;
+    std::cerr << "[WARN] Unknown optimizer: " << s << ", using adam\n";
+    return OptimizerType::Adam; // default
+}
+
 Config ArgParser::parse(int argc, char** argv) {
     Config cfg;
 
     if (argc < 2) {
         std::cerr << "Usage: medcxx <model> [options]\n"
+                  << "       medcxx quantize <model> --weights <path> [options]\n"
+                  << "       medcxx serve <model> --weights <path> [options]\n"
                   << "  <model>: unet | densenet | resnet\n"
                   << "Options:\n"
                   << "  --train-dir <path>       Path to training data\n"
                   << "  --test-dir <path>        Path to test data\n"
                   << "  --model-name <name>      Human‐readable name (prefixed by model)\n"
-                  << "  --weights <path>         Path to .pt weights (load & skip training)\n"
+                  << "  --weights <path>         Path to .pt or .medw weights (load & skip training)\n"
+                  << "  --pretrained <path>      torchvision ResNet/DenseNet state dict to start from\n"
+                  << "  --export <path>          Write a frozen, optimized TorchScript model\n"
+                  << "  --scripted <path>        Evaluate an exported TorchScript model\n"
+                  << "  --save-mapped <path>     Also save weights as mmap-able .medw (fast loading)\n"
                   << "  --skip-training          Skip training entirely\n"
                   << "  --cuda                   Use CUDA if available\n"
                   << "  --epochs, -e <N>         Number of epochs (default 50)\n"
                   << "  --lr, -l <LR>            Learning rate (default 1e-3)\n"
+                  << "  --optimizer <OPT>        adam | adamw | sgd (default adam)\n"
+                  << "  --weight-decay <WD>      L2 (adam, sgd) or decoupled (adamw) decay (default 0)\n"
+                  << "  --momentum <M>           SGD momentum (default 0.9)\n"
+                  << "  --batch-size, -b <N>     Samples per micro-batch (default 1)\n"
+                  << "  --eval-batch-size <N>    Images per inference batch in evaluation (default 16)\n"
+                  << "  --fold-bn                Fold BatchNorm into convs for evaluation\n"
+                  << "  --int8                   --weights holds an int8 model from \"quantize\"\n"
+                  << "  --calib-samples <N>      Training images for int8 calibration (default 256)\n"
+                  << "  --arena                  UNet inference from a preallocated activation arena\n"
+                  << "  --tile <N>               UNet evaluation in NxN native-resolution tiles (default: --train-crop)\n"
+                  << "  --tile-stride <N>        Tile step (default N/2)\n"
+                  << "  --tile-blend <B>         gaussian | linear overlap blending (default gaussian)\n"
+                  << "  --tta <N>                Test-time augmentation: average N flip/rotate views (1-8)\n"
+                  << "  --socket <path>          serve: Unix socket (default /tmp/medcxx.sock)\n"
+                  << "  --port <N>               serve: listen on localhost:N instead\n"
+                  << "  --max-batch <N>          serve: requests per batch (default 16)\n"
+                  << "  --max-wait-ms <MS>       serve: max wait for a batch to fill (default 5)\n"
+                  << "  --report-every <S>       serve: stats period in seconds (default 10)\n"
+                  << "  --accumulate-steps <N>   Micro-batches per optimizer step (default 1)\n"
+                  << "  --image-size <N>         Training resolution (default 256 UNet, 224 others)\n"
+                  << "  --resize-schedule <LIST> Progressive resizing, e.g. 128,192,256\n"
+                  << "  --train-crop <N>         UNet: train on random NxN native-resolution crops\n"
+                  << "  --channels-last          NHWC weights and inputs\n"
+                  << "  --importance-sampling    Draw samples by running loss (reweighted)\n"
+                  << "  --is-warmup <N>          Uniform epochs before sampling (default 2)\n"
+                  << "  --is-fraction <F>        Samples drawn per epoch / dataset size (default 0.5)\n"
+                  << "  --is-mix <F>             Uniform share of the sampling distribution, 0.01-1 (default 0.2)\n"
+                  << "  --head-only              Train only the classifier head on cached embeddings\n"
+                  << "  --feature-cache <path>   Embedding cache (default <model-name>_features.bin)\n"
+                  << "  --teacher <path>         Distill from this teacher (same model type)\n"
+                  << "  --teacher-resnet <VER>   Teacher ResNet version (default R101)\n"
+                  << "  --teacher-unet-width <F> Teacher UNet width (default 1.0)\n"
+                  << "  --teacher-unet-depth <N> Teacher UNet depth (default 4)\n"
+                  << "  --distill-alpha <A>      Weight of the teacher loss (default 0.5)\n"
+                  << "  --distill-temp <T>       Distillation temperature (default 2)\n"
+                  << "  --autotune               Pick batch size, threads, channels-last by timing\n"
+                  << "  --autotune-cache <path>  Autotune results (default med-cxx.autotune)\n"
+                  << "  --mem-budget <MB>        Autotune peak memory budget (GPU memory with --cuda)\n"
+                  << "  --checkpoint-every <N>   Checkpoint every N optimizer steps (default off)\n"
+                  << "  --checkpoint-path <path> Checkpoint file (default <model-name>_ckpt.pt)\n"
+                  << "  --resume <path>          Resume training from a checkpoint\n"
+                  << "  --val-split <F>          Hold out a fraction of train data for validation\n"
+                  << "  --val-every <N>          Epochs between validation passes (default 1)\n"
+                  << "  --early-stop <N>         Stop after N validations without improvement\n"
+                  << "  --threads <N>            libtorch intra-op threads\n"
+                  << "  --interop-threads <N>    libtorch inter-op threads\n"
+                  << "  --cv-threads <N>         OpenCV threads (0 = sequential)\n"
+                  << "  --loader-workers <N>     Background sample-loading threads (default 0)\n"
+                  << "  --compute-cores <LIST>   Pin compute threads, e.g. 0-15\n"
+                  << "  --loader-cores <LIST>    Pin loader workers\n"
+                  << "  --io-cores <LIST>        Pin checkpoint/progress threads\n"
+                  << "  --video-cores <LIST>     Pin the video encoder\n"
+                  << "  --numa-node <N>          Compute cores + allocations on NUMA node N (memory policy is process-wide)\n"
+                  << "  --target-score <F>       Report time to reach this validation score\n"
                   << "  --bce-weight <W>         BCE positive weight (segmentation)\n"
+                  << "  --unet-width <F>         UNet channel multiplier (default 1.0 = 64..1024)\n"
+                  << "  --unet-depth <N>         UNet down-sampling levels, 1-4 (default 4)\n"
+                  << "  --separable              Depthwise-separable UNet convolutions\n"
+                  << "  --bilinear               Bilinear UNet upsampling instead of transposed convs\n"
+                  << "  --profile                Report params, FLOPs, latency and test score\n"
                   << "  --resnet-version <VER>   R18|R34|R50|R101|R152 (default R18)\n"
+                  << "  --in-channels <N>        Classifier stem channels, 1 or 3 (default 1)\n"
                   << "  --no-video               Disable writing a demo video\n"
                   << "  --fps <N>                FPS for video (default 1)\n"
-                  << "  --hold <N>               Frames to hold each sample (default 2)\n\n";
+                  << "  --hold <N>               Frames to hold each sample (default 2)\n"
+                  << "  --log-every <N>          Micro-batches between loss read-backs (default 50)\n"
+                  << "  --progress-ms <N>        Progress bar refresh period in ms (default 250)\n\n";
         std::exit(EXIT_FAILURE);
     }
 
+    // "quantize" / "serve" workflows: the model follows as the next argument
+    int modelArg = 1;
+    std::string command = toLower(argv[1]);
+    if (command == "quantize" || command == "serve") {
+        cfg.quantize = (command == "quantize");
+        cfg.serve = (command == "serve");
+        cfg.skipTraining = true;
+        modelArg = 2;
+        if (argc < 3) {
+            std::cerr << "Usage: medcxx " << command << " <model> --weights <path> [options]\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
     // Model type
-    std::string modelStr = toLower(argv[1]);
+    std::string modelStr = toLower(argv[modelArg]);
     if (modelStr == "unet")         
         cfg.modelType = ModelType::UNet;
     else if (modelStr == "densenet")
@@ -56,12 +171,12 @@ Config ArgParser::parse(int argc, char** argv) {
     else if (modelStr == "resnet")  
         cfg.modelType = ModelType::ResNet;
     else {
-        std::cerr << "[ERROR] Unknown model: " << argv[1] << "\n";
+        std::cerr << "[ERROR] Unknown model: " << argv[modelArg] << "\n";
         std::exit(EXIT_FAILURE);
     }
 
     // Scan the rest of argv for options
-    for (int i = 2; i < argc; ++i) {
+    for (int i = modelArg + 1; i < argc; ++i) {
         std::string arg = argv[i];
 
         if (arg == "--train-dir" && i+1 < argc) {
@@ -82,6 +197,19 @@ Config ArgParser::parse(int argc, char** argv) {
         else if ((arg == "--weights" || arg == "-w") && i+1 < argc) {
             cfg.modelWeightsPath = argv[++i];
         }
+        else if ((arg == "--pretrained") && i+1 < argc) {
+            cfg.pretrainedPath = argv[++i];
+        }
+        else if ((arg == "--export") && i+1 < argc) {
+            cfg.exportPath = argv[++i];
+        }
+        else if ((arg == "--scripted") && i+1 < argc) {
+            cfg.scriptedPath = argv[++i];
+            cfg.skipTraining = true;
+        }
+        else if ((arg == "--save-mapped") && i+1 < argc) {
+            cfg.mappedPath = argv[++i];
+        }
         else if (arg == "--skip-training") {
             cfg.skipTraining = true;
         }
@@ -95,12 +223,196 @@ Config ArgParser::parse(int argc, char** argv) {
         else if ((arg == "--lr" || arg == "-l") && i+1 < argc) {
             cfg.learningRate = std::stod(argv[++i]);
         }
+        else if ((arg == "--optimizer") && i+1 < argc) {
+            cfg.optimizer = parseOptimizerType(argv[++i]);
+        }
+        else if ((arg == "--weight-decay") && i+1 < argc) {
+            cfg.weightDecay = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if ((arg == "--momentum") && i+1 < argc) {
+            cfg.momentum = std::clamp(std::stod(argv[++i]), 0.0, 1.0);
+        }
+        else if ((arg == "--batch-size" || arg == "-b") && i+1 < argc) {
+            cfg.batchSize = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if ((arg == "--eval-batch-size") && i+1 < argc) {
+            cfg.evalBatchSize = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if (arg == "--fold-bn") {
+            cfg.foldBN = true;
+        }
+        else if (arg == "--int8") {
+            cfg.int8 = true;
+        }
+        else if (arg == "--arena") {
+            cfg.activationArena = true;
+        }
+        else if ((arg == "--calib-samples") && i+1 < argc) {
+            cfg.calibSamples = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if ((arg == "--tile") && i+1 < argc) {
+            cfg.tileSize = std::max(0, std::stoi(argv[++i]));
+        }
+        else if ((arg == "--tile-stride") && i+1 < argc) {
+            cfg.tileStride = std::max(0, std::stoi(argv[++i]));
+        }
+        else if ((arg == "--tile-blend") && i+1 < argc) {
+            cfg.tileBlend = parseTileBlend(argv[++i]);
+        }
+        else if ((arg == "--tta") && i+1 < argc) {
+            cfg.ttaViews = std::clamp(std::stoi(argv[++i]), 1, 8);
+        }
+        else if ((arg == "--socket") && i+1 < argc) {
+            cfg.serveSocket = argv[++i];
+        }
+        else if ((arg == "--port") && i+1 < argc) {
+            cfg.servePort = std::clamp(std::stoi(argv[++i]), 0, 65535);
+        }
+        else if ((arg == "--max-batch") && i+1 < argc) {
+            cfg.serveMaxBatch = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if ((arg == "--max-wait-ms") && i+1 < argc) {
+            cfg.serveMaxWaitMs = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if ((arg == "--report-every") && i+1 < argc) {
+            cfg.serveReportSec = std::max(1, std::stoi(argv[++i]));
+        }
+        else if ((arg == "--accumulate-steps") && i+1 < argc) {
+            cfg.accumulateSteps = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if ((arg == "--image-size") && i+1 < argc) {
+            cfg.imageSize = std::max(0, std::stoi(argv[++i]));
+        }
+        else if ((arg == "--resize-schedule") && i+1 < argc) {
+            cfg.resizeSchedule = parseSizeList(argv[++i]);
+        }
+        else if ((arg == "--train-crop") && i+1 < argc) {
+            cfg.trainCrop = std::max(0, std::stoi(argv[++i]));
+        }
+        else if (arg == "--channels-last") {
+            cfg.channelsLast = true;
+        }
+        else if (arg == "--importance-sampling") {
+            cfg.importanceSampling = true;
+        }
+        else if ((arg == "--is-warmup") && i+1 < argc) {
+            cfg.isWarmupEpochs = static_cast<size_t>(std::stoul(argv[++i]));
+        }
+        else if ((arg == "--is-fraction") && i+1 < argc) {
+            cfg.isFraction = std::clamp(std::stod(argv[++i]), 0.01, 1.0);
+        }
+        else if ((arg == "--is-mix") && i+1 < argc) {
+            // At least 1% uniform: caps every importance weight 1/(N p) at 100
+            cfg.isUniformMix = std::clamp(std::stod(argv[++i]), 0.01, 1.0);
+        }
+        else if ((arg == "--teacher") && i+1 < argc) {
+            cfg.teacherPath = argv[++i];
+        }
+        else if ((arg == "--teacher-resnet") && i+1 < argc) {
+            cfg.teacherResNetVersion = parseResNetVersion(argv[++i]);
+        }
+        else if ((arg == "--teacher-unet-width") && i+1 < argc) {
+            cfg.teacherUnetWidth = std::max(1.0 / 64, std::stod(argv[++i]));
+        }
+        else if ((arg == "--teacher-unet-depth") && i+1 < argc) {
+            cfg.teacherUnetDepth = std::clamp(std::stoi(argv[++i]), 1, 4);
+        }
+        else if ((arg == "--distill-alpha") && i+1 < argc) {
+            cfg.distillAlpha = std::clamp(std::stod(argv[++i]), 0.0, 1.0);
+        }
+        else if ((arg == "--distill-temp") && i+1 < argc) {
+            cfg.distillTemperature = std::max(1e-3, std::stod(argv[++i]));
+        }
+        else if (arg == "--head-only") {
+            cfg.headOnly = true;
+        }
+        else if ((arg == "--feature-cache") && i+1 < argc) {
+            cfg.featureCachePath = argv[++i];
+        }
+        else if (arg == "--autotune") {
+            cfg.autotune = true;
+        }
+        else if ((arg == "--autotune-cache") && i+1 < argc) {
+            cfg.autotuneCache = argv[++i];
+        }
+        else if ((arg == "--mem-budget") && i+1 < argc) {
+            cfg.autotuneMemoryMB = static_cast<size_t>(std::stoul(argv[++i]));
+        }
+        else if ((arg == "--checkpoint-every") && i+1 < argc) {
+            cfg.checkpointEvery = static_cast<size_t>(std::stoul(argv[++i]));
+        }
+        else if ((arg == "--checkpoint-path") && i+1 < argc) {
+            cfg.checkpointPath = argv[++i];
+        }
+        else if ((arg == "--resume") && i+1 < argc) {
+            cfg.resumePath = argv[++i];
+        }
+        else if ((arg == "--val-split") && i+1 < argc) {
+            cfg.valSplit = std::clamp(std::stod(argv[++i]), 0.0, 0.9);
+        }
+        else if ((arg == "--val-every") && i+1 < argc) {
+            cfg.valEvery = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if ((arg == "--early-stop") && i+1 < argc) {
+            cfg.earlyStopPatience = static_cast<size_t>(std::stoul(argv[++i]));
+        }
+        else if ((arg == "--threads") && i+1 < argc) {
+            cfg.intraOpThreads = std::max(0, std::stoi(argv[++i]));
+        }
+        else if ((arg == "--interop-threads") && i+1 < argc) {
+            cfg.interOpThreads = std::max(0, std::stoi(argv[++i]));
+        }
+        else if ((arg == "--cv-threads") && i+1 < argc) {
+            cfg.cvThreads = std::stoi(argv[++i]);
+        }
+        else if ((arg == "--loader-workers") && i+1 < argc) {
+            cfg.loaderWorkers = static_cast<size_t>(std::stoul(argv[++i]));
+        }
+        else if ((arg == "--compute-cores") && i+1 < argc) {
+            cfg.computeCores = argv[++i];
+        }
+        else if ((arg == "--loader-cores") && i+1 < argc) {
+            cfg.loaderCores = argv[++i];
+        }
+        else if ((arg == "--io-cores") && i+1 < argc) {
+            cfg.ioCores = argv[++i];
+        }
+        else if ((arg == "--video-cores") && i+1 < argc) {
+            cfg.videoCores = argv[++i];
+        }
+        else if ((arg == "--numa-node") && i+1 < argc) {
+            cfg.numaNode = std::stoi(argv[++i]);
+        }
+        else if ((arg == "--target-score") && i+1 < argc) {
+            cfg.targetScore = std::stod(argv[++i]);
+        }
         else if ((arg == "--bce-weight") && i+1 < argc) {
             cfg.bcePosWeight = std::stod(argv[++i]);
         }
+        else if ((arg == "--unet-width") && i+1 < argc) {
+            cfg.unetWidth = std::max(1.0 / 64, std::stod(argv[++i]));
+        }
+        else if ((arg == "--unet-depth") && i+1 < argc) {
+            cfg.unetDepth = std::clamp(std::stoi(argv[++i]), 1, 4);
+        }
+        else if (arg == "--separable") {
+            cfg.unetSeparable = true;
+        }
+        else if (arg == "--bilinear") {
+            cfg.unetBilinear = true;
+        }
+        else if (arg == "--profile") {
+            cfg.profileModel = true;
+        }
         else if ((arg == "--resnet-version") && i+1 < argc) {
             cfg.resnetVersion = parseResNetVersion(argv[++i]);
         }
+        else if ((arg == "--in-channels") && i+1 < argc) {
+            cfg.inChannels = std::stoi(argv[++i]);
+            if (cfg.inChannels != 1 && cfg.inChannels != 3) {
+                throw error::ConfigException("--in-channels", "expected 1 or 3, got " + std::to_string(cfg.inChannels));
+            }
+        }
         else if (arg == "--no-video") {
             cfg.makeVideo = false;
         }
@@ -110,23 +422,97 @@ Config ArgParser::parse(int argc, char** argv) {
         else if ((arg == "--hold") && i+1 < argc) {
             cfg.holdFrames = std::stoi(argv[++i]);
         }
+        else if ((arg == "--log-every") && i+1 < argc) {
+            cfg.logEvery = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if ((arg == "--progress-ms") && i+1 < argc) {
+            cfg.progressIntervalMs = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
         else if ((arg == "--help") || (arg == "-h")) {
             std::cout << "Usage: medcxx <model> [options]\n"
+                      << "       medcxx quantize <model> --weights <path> [options]\n"
+                      << "       medcxx serve <model> --weights <path> [options]\n"
                       << "  <model>: unet | densenet | resnet\n"
                       << "Options:\n"
                       << "  --train-dir <path>       Path to training data\n"
                       << "  --test-dir <path>        Path to test data\n"
                       << "  --model-name <name>      Human‐readable name (prefixed by model)\n"
-                      << "  --weights <path>         Path to .pt weights (load & skip training)\n"
+                      << "  --weights <path>         Path to .pt or .medw weights (load & skip training)\n"
+                      << "  --pretrained <path>      torchvision ResNet/DenseNet state dict to start from\n"
+                      << "  --export <path>          Write a frozen, optimized TorchScript model\n"
+                      << "  --scripted <path>        Evaluate an exported TorchScript model\n"
+                      << "  --save-mapped <path>     Also save weights as mmap-able .medw (fast loading)\n"
                       << "  --skip-training          Skip training entirely\n"
                       << "  --cuda                   Use CUDA if available\n"
                       << "  --epochs, -e <N>         Number of epochs (default 50)\n"
                       << "  --lr, -l <LR>            Learning rate (default 1e-3)\n"
+                      << "  --optimizer <OPT>        adam | adamw | sgd (default adam)\n"
+                      << "  --weight-decay <WD>      L2 (adam, sgd) or decoupled (adamw) decay (default 0)\n"
+                      << "  --momentum <M>           SGD momentum (default 0.9)\n"
+                      << "  --batch-size, -b <N>     Samples per micro-batch (default 1)\n"
+                      << "  --eval-batch-size <N>    Images per inference batch in evaluation (default 16)\n"
+                      << "  --fold-bn                Fold BatchNorm into convs for evaluation\n"
+                      << "  --int8                   --weights holds an int8 model from \"quantize\"\n"
+                      << "  --calib-samples <N>      Training images for int8 calibration (default 256)\n"
+                      << "  --arena                  UNet inference from a preallocated activation arena\n"
+                      << "  --tile <N>               UNet evaluation in NxN native-resolution tiles (default: --train-crop)\n"
+                      << "  --tile-stride <N>        Tile step (default N/2)\n"
+                      << "  --tile-blend <B>         gaussian | linear overlap blending (default gaussian)\n"
+                      << "  --tta <N>                Test-time augmentation: average N flip/rotate views (1-8)\n"
+                      << "  --socket <path>          serve: Unix socket (default /tmp/medcxx.sock)\n"
+                      << "  --port <N>               serve: listen on localhost:N instead\n"
+                      << "  --max-batch <N>          serve: requests per batch (default 16)\n"
+                      << "  --max-wait-ms <MS>       serve: max wait for a batch to fill (default 5)\n"
+                      << "  --report-every <S>       serve: stats period in seconds (default 10)\n"
+                      << "  --accumulate-steps <N>   Micro-batches per optimizer step (default 1)\n"
+                      << "  --image-size <N>         Training resolution (default 256 UNet, 224 others)\n"
+                      << "  --resize-schedule <LIST> Progressive resizing, e.g. 128,192,256\n"
+                      << "  --train-crop <N>         UNet: train on random NxN native-resolution crops\n"
+                      << "  --channels-last          NHWC weights and inputs\n"
+                      << "  --importance-sampling    Draw samples by running loss (reweighted)\n"
+                      << "  --is-warmup <N>          Uniform epochs before sampling (default 2)\n"
+                      << "  --is-fraction <F>        Samples drawn per epoch / dataset size (default 0.5)\n"
+                      << "  --is-mix <F>             Uniform share of the sampling distribution, 0.01-1 (default 0.2)\n"
+                      << "  --head-only              Train only the classifier head on cached embeddings\n"
+                      << "  --feature-cache <path>   Embedding cache (default <model-name>_features.bin)\n"
+                      << "  --teacher <path>         Distill from this teacher (same model type)\n"
+                      << "  --teacher-resnet <VER>   Teacher ResNet version (default R101)\n"
+                      << "  --teacher-unet-width <F> Teacher UNet width (default 1.0)\n"
+                      << "  --teacher-unet-depth <N> Teacher UNet depth (default 4)\n"
+                      << "  --distill-alpha <A>      Weight of the teacher loss (default 0.5)\n"
+                      << "  --distill-temp <T>       Distillation temperature (default 2)\n"
+                      << "  --autotune               Pick batch size, threads, channels-last by timing\n"
+                      << "  --autotune-cache <path>  Autotune results (default med-cxx.autotune)\n"
+                      << "  --mem-budget <MB>        Autotune peak memory budget (GPU memory with --cuda)\n"
+                      << "  --checkpoint-every <N>   Checkpoint every N optimizer steps (default off)\n"
+                      << "  --checkpoint-path <path> Checkpoint file (default <model-name>_ckpt.pt)\n"
+                      << "  --resume <path>          Resume training from a checkpoint\n"
+                      << "  --val-split <F>          Hold out a fraction of train data for validation\n"
+                      << "  --val-every <N>          Epochs between validation passes (default 1)\n"
+                      << "  --early-stop <N>         Stop after N validations without improvement\n"
+                      << "  --threads <N>            libtorch intra-op threads\n"
+                      << "  --interop-threads <N>    libtorch inter-op threads\n"
+                      << "  --cv-threads <N>         OpenCV threads (0 = sequential)\n"
+                      << "  --loader-workers <N>     Background sample-loading threads (default 0)\n"
+                      << "  --compute-cores <LIST>   Pin compute threads, e.g. 0-15\n"
+                      << "  --loader-cores <LIST>    Pin loader workers\n"
+                      << "  --io-cores <LIST>        Pin checkpoint/progress threads\n"
+                      << "  --video-cores <LIST>     Pin the video encoder\n"
+                      << "  --numa-node <N>          Compute cores + allocations on NUMA node N (memory policy is process-wide)\n"
+                      << "  --target-score <F>       Report time to reach this validation score\n"
                       << "  --bce-weight <W>         BCE positive weight (segmentation)\n"
+                      << "  --unet-width <F>         UNet channel multiplier (default 1.0 = 64..1024)\n"
+                      << "  --unet-depth <N>         UNet down-sampling levels, 1-4 (default 4)\n"
+                      << "  --separable              Depthwise-separable UNet convolutions\n"
+                      << "  --bilinear               Bilinear UNet upsampling instead of transposed convs\n"
+                      << "  --profile                Report params, FLOPs, latency and test score\n"
                       << "  --resnet-version <VER>   R18|R34|R50|R101|R152 (default R18)\n"
+                      << "  --in-channels <N>        Classifier stem channels, 1 or 3 (default 1)\n"
                       << "  --no-video               Disable writing a demo video\n"
                       << "  --fps <N>                FPS for video (default 1)\n"
                       << "  --hold <N>               Frames to hold each sample (default 2)\n"
+                      << "  --log-every <N>          Micro-batches between loss read-backs (default 50)\n"
+                      << "  --progress-ms <N>        Progress bar refresh period in ms (default 250)\n"
                       << std::endl;
             std::exit(EXIT_SUCCESS);
         }
@@ -135,6 +521,36 @@ Config ArgParser::parse(int argc, char** argv) {
         }
     }
 
+    // UNet halves its input unetDepth times and concatenates the skips on the way up, so
+    // every scheduled side must be a multiple of 2^unetDepth (checked once all options are in)
+    if (cfg.modelType == ModelType::UNet) {
+        const int step = 1 << cfg.unetDepth;
+        auto roundSide = [step](const char* option, int& side) {
+            int rounded = (side + step - 1) / step * step;
+            if (rounded != side) {
+                std::cerr << "[WARN] " << option << ": " << side << " is not a multiple of " << step
+                          << " (2^unet-depth), using " << rounded << "\n";
+                side = rounded;
+            }
+        };
+        for (int& side : cfg.resizeSchedule) roundSide("--resize-schedule", side);
+        if (cfg.trainCrop > 0) roundSide("--train-crop", cfg.trainCrop);
+    }
+
+    // Crop training: the model sees native-scale NxN windows, so evaluation tiles at N
+    if (cfg.trainCrop > 0) {
+        if (cfg.modelType != ModelType::UNet) {
+            throw error::ConfigException("--train-crop", "only UNet trains on crops");
+        }
+        if (!cfg.resizeSchedule.empty()) {
+            throw error::ConfigException("--train-crop", "crops are taken at native resolution; drop --resize-schedule");
+        }
+        if (!cfg.teacherPath.empty()) {
+            throw error::ConfigException("--train-crop", "teacher outputs are cached for whole images; drop --teacher");
+        }
+        if (cfg.tileSize == 0) cfg.tileSize = cfg.trainCrop;
+    }
+
     return cfg;
 }
 
@@ -13,12 +13,38 @@ enum class ModelType { UNet, DenseNet, ResNet, Unknown };
 // Which ResNet version (if ModelType::ResNet)
 enum class ResNetVersion { R18, R34, R50, R101, R152 };
 
+// Which optimizer the trainers use (see optim::FusedOptimizer)
+enum class OptimizerType { Adam, AdamW, SGD };
+
+// How overlapping tiles are blended in tiled segmentation (see eval::TiledPredictor)
+enum class TileBlend { Gaussian, Linear };
+
 struct Config {
     // Global
     ModelType modelType = ModelType::Unknown;
     std::string modelName = "";
     std::string modelWeightsPath = "";
+    std::string pretrainedPath = ""; // torchvision state dict to start from (ResNet/DenseNet)
+    std::string exportPath = ""; // write a frozen TorchScript artifact of the final model
+    std::string scriptedPath = ""; // evaluate an exported TorchScript artifact (no training)
+    std::string mappedPath = ""; // also write the weights in the memory-mapped MEDW format
     bool skipTraining = false;
+    bool quantize = false; // "medcxx quantize <model>": calibrate, convert to int8, compare, save
+    bool int8 = false; // --weights holds an int8 model written by "quantize"
+    size_t calibSamples = 256; // training images used to calibrate activation ranges
+
+    // Inference server ("medcxx serve <model>")
+    bool serve = false;
+    std::string serveSocket = "/tmp/medcxx.sock"; // Unix domain socket path
+    int servePort = 0; // listen on localhost:port instead of the socket (0 = socket)
+    size_t serveMaxBatch = 16; // requests coalesced into one forward pass
+    double serveMaxWaitMs = 5.0; // longest a request waits for its batch to fill
+    int serveReportSec = 10; // throughput / latency report period
+    int tileSize = 0; // UNet evaluation: sliding-window tiles at native resolution (0 = resize the whole image)
+    int tileStride = 0; // tile step (0 = tileSize / 2)
+    TileBlend tileBlend = TileBlend::Gaussian;
+    bool activationArena = false; // UNet inference: reuse a planned activation arena across calls
+    int ttaViews = 1; // evaluation: flip/rotate views averaged per image (1 = off, up to 8)
 
     // Device
     bool useCUDA = false;
@@ -27,16 +53,81 @@ struct Config {
     // Common hyperparameters
     size_t epochs = 50;
     double learningRate = 1e-3;
+    OptimizerType optimizer = OptimizerType::Adam;
+    double weightDecay = 0.0; // L2 (Adam, SGD) or decoupled (AdamW) weight decay
+    double momentum = 0.9; // SGD only
+    size_t batchSize = 1; // samples per micro-batch (forward/backward pass)
+    size_t evalBatchSize = 16; // images per forward pass in evaluate()
+    bool foldBN = false; // fold BatchNorm into the convolutions before evaluate()
+    size_t accumulateSteps = 1; // micro-batches accumulated per optimizer step
+
+    bool channelsLast = false; // NHWC weights and inputs
+    int imageSize = 0; // full training resolution (0 = model default: 256 UNet, 224 DenseNet/ResNet)
+    std::vector<int> resizeSchedule; // progressive resizing: sides spread evenly over the epochs
+    int trainCrop = 0; // UNet: train on random NxN crops at native resolution; also the input size (0 = resize whole images)
+
+    // Importance sampling (draw samples by running loss, reweight by 1/(N p))
+    bool importanceSampling = false;
+    size_t isWarmupEpochs = 2; // uniform epochs before sampling starts
+    double isFraction = 0.5; // samples drawn per epoch, as a fraction of the dataset
+    double isUniformMix = 0.2; // share of uniform probability mixed in (>= 0.01, so weights stay <= 1/mix)
+    double isSmoothing = 0.7; // EMA factor of the per-sample loss
+
+    // Knowledge distillation from a frozen teacher of the same model type
+    std::string teacherPath = ""; // teacher weights (.pt); empty = off
+    ResNetVersion teacherResNetVersion = ResNetVersion::R101;
+    double teacherUnetWidth = 1.0;
+    int teacherUnetDepth = 4;
+    double distillAlpha = 0.5; // weight of the soft-target loss (1 - alpha on the labels)
+    double distillTemperature = 2.0; // softening of teacher and student logits
+
+    // Head-only fine-tuning (classifiers): embed the dataset once, then train only fc/classifier
+    bool headOnly = false;
+    std::string featureCachePath = ""; // default: <model-name>_features.bin
+
+    // Autotuning (batch size, intra-op threads, channels-last)
+    bool autotune = false;
+    std::string autotuneCache = "med-cxx.autotune"; // results per (model, input size, device, host)
+    size_t autotuneMemoryMB = 0; // peak memory budget (0 = RSS + 80% of available, or 90% of the GPU)
+    size_t autotuneSteps = 3; // timed steps per candidate
+    size_t autotuneMaxBatch = 64;
+
+    // Checkpointing
+    size_t checkpointEvery = 0; // optimizer steps between checkpoints (0 = off)
+    std::string checkpointPath = ""; // default: <model-name>_ckpt.pt
+    std::string resumePath = ""; // checkpoint to resume training from
+
+    // Validation during training
+    double valSplit = 0.0; // fraction of the training set held out (0 = off)
+    size_t valEvery = 1; // epochs between validation passes
+    size_t earlyStopPatience = 0; // stop after N passes without improvement (0 = off)
+    double targetScore = 0.0; // report time to reach this validation Dice/accuracy (0 = off)
+
+    // Threads & affinity (CPU lists like "0-7,16-23"; empty = not pinned)
+    int intraOpThreads = 0; // libtorch intra-op threads (0 = one per compute core, else libtorch default)
+    int interOpThreads = 0; // libtorch inter-op threads (0 = libtorch default)
+    int cvThreads = -1; // OpenCV threads (-1 = OpenCV default, 0 = sequential)
+    size_t loaderWorkers = 0; // background sample-loading threads (0 = load on the training thread)
+    std::string computeCores = ""; // training/inference + validation threads
+    std::string loaderCores = "";
+    std::string ioCores = ""; // checkpoint writer, progress reporter
+    std::string videoCores = ""; // video encoder
+    int numaNode = -1; // compute cores + memory on this NUMA node (-1 = off)
 
     // Segmentation‐specific
     std::string segTrainDir = ""; // path to train/images & train/masks
     std::string segTestDir = ""; // path to test/images & optional test/masks
     double bcePosWeight = 1.0; // for weighted BCE
+    double unetWidth = 1.0; // channel multiplier (1.0 = 64..1024)
+    int unetDepth = 4; // down-sampling levels, 1-4
+    bool unetSeparable = false; // depthwise-separable DoubleConv
+    bool unetBilinear = false; // bilinear Up instead of ConvTranspose2d
 
     // Classification‐specific (DenseNet/ResNet)
     std::string clsTrainDir = "";
     std::string clsTestDir = "";
     ResNetVersion resnetVersion = ResNetVersion::R18;
+    int inChannels = 1; // stem input channels: 1 = grayscale as is, 3 = replicated (RGB-style stem)
 
     // Visualizer options
     bool makeVideo = true;
@@ -45,16 +136,39 @@ struct Config {
 
     // Miscellaneous
     size_t printBarWidth = 50;
+    bool profileModel = false; // report params, FLOPs, latency and the test score
+    size_t logEvery = 50; // micro-batches between loss read-backs from the device
+    size_t progressIntervalMs = 250; // progress bar refresh period
 };
 
 //
 // A very minimal parser: expects arguments in the form:
-//   medcxx <model> [--train-dir PATH] [--test-dir PATH]
-//           [--model-name NAME] [--weights path]
+//   medcxx [quantize|serve] <model> [--train-dir PATH] [--test-dir PATH]
+//           [--model-name NAME] [--weights path] [--pretrained path]
+//           [--export path] [--scripted path] [--save-mapped path]
 //           [--skip-training] [--cuda]
 //           [--epochs N] [--lr LR] [--bce-weight W]
-//           [--resnet-version R18|R34|R50|R101|R152]
+//           [--unet-width F] [--unet-depth N] [--separable] [--bilinear] [--profile]
+//           [--optimizer adam|adamw|sgd] [--weight-decay WD] [--momentum M]
+//           [--batch-size N] [--accumulate-steps N] [--eval-batch-size N] [--channels-last]
+//           [--image-size N] [--resize-schedule LIST] [--train-crop N]
+//           [--fold-bn] [--int8] [--calib-samples N] [--arena]
+//           [--tile N] [--tile-stride N] [--tile-blend gaussian|linear] [--tta N]
+//           [--socket PATH] [--port N] [--max-batch N] [--max-wait-ms MS] [--report-every S]
+//           [--autotune] [--autotune-cache PATH] [--mem-budget MB]
+//           [--importance-sampling] [--is-warmup N] [--is-fraction F] [--is-mix F]
+//           [--head-only] [--feature-cache PATH]
+//           [--teacher PATH] [--teacher-resnet VER] [--teacher-unet-width F]
+//           [--teacher-unet-depth N] [--distill-alpha A] [--distill-temp T]
+//           [--checkpoint-every N] [--checkpoint-path PATH] [--resume PATH]
+//           [--val-split F] [--val-every N] [--early-stop N] [--target-score F]
+//           [--image-size N] [--resize-schedule S1,S2,...]
+//           [--threads N] [--interop-threads N] [--cv-threads N] [--loader-workers N]
+//           [--compute-cores LIST] [--loader-cores LIST] [--io-cores LIST]
+//           [--video-cores LIST] [--numa-node N]
+//           [--resnet-version R18|R34|R50|R101|R152] [--in-channels 1|3]
 //           [--no-video] [--fps N] [--hold N]
+//           [--log-every N] [--progress-ms N]
 //  
 
 class ArgParser {
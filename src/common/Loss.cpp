@@ -1,8 +1,201 @@
 #include "Loss.hpp"
+#include "LossKernel.hpp"
+#include "common/Exception.hpp"
+#include <ATen/Parallel.h>
+#include <algorithm>
 
 torch::Tensor med::loss::diceLoss(torch::Tensor preds, torch::Tensor targets) {
     preds = torch::sigmoid(preds);
     auto intersection = (preds * targets).sum();
     auto union_ = preds.sum() + targets.sum();
     return 1.0 - 2.0 * intersection / (union_ + 1e-6);
-}
\ No newline at end of file
+}
+
+namespace {
+
+using namespace med::loss::kernel;
+
+constexpr double kDiceEps = 1e-6;
+constexpr int64_t kChunk = 1 << 14; // elements per parallel work item
+
+// Chunk kernels for the widest instruction set this CPU supports (see LossKernel.hpp)
+struct ChunkKernels {
+    decltype(&DEFAULT::forwardChunk) forward;
+    decltype(&DEFAULT::backwardChunk) backward;
+};
+
+const ChunkKernels& chunkKernels() {
+    static const ChunkKernels kernels = [] {
+#ifdef MED_WITH_AVX2
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return ChunkKernels{&AVX2::forwardChunk, &AVX2::backwardChunk};
+        }
+#endif
+        return ChunkKernels{&DEFAULT::forwardChunk, &DEFAULT::backwardChunk};
+    }();
+    return kernels;
+}
+
+// CPU float kernel: one vectorized sweep computes sigmoid, BCE and the three Dice sums.
+// Work is split into (sample, chunk) items so small batches still use every core.
+void forwardCPU(const torch::Tensor& x, const torch::Tensor& t, double posWeight,
+                torch::Tensor& probs, torch::Tensor& stats) {
+    const int64_t B = x.size(0);
+    const int64_t n = x.size(1);
+    const int64_t chunks = (n + kChunk - 1) / kChunk;
+    const float w = static_cast<float>(posWeight);
+
+    probs = torch::empty_like(x);
+    auto partial = torch::zeros({B * chunks, NumStats}, torch::kDouble);
+
+    const float* xp = x.data_ptr<float>();
+    const float* tp = t.data_ptr<float>();
+    float* pp = probs.data_ptr<float>();
+    double* part = partial.data_ptr<double>();
+
+    const auto& kernels = chunkKernels();
+    at::parallel_for(0, B * chunks, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t job = begin; job < end; ++job) {
+            const int64_t b = job / chunks, c = job % chunks;
+            const int64_t lo = b * n + c * kChunk;
+            const int64_t hi = b * n + std::min(n, (c + 1) * kChunk);
+            kernels.forward(xp + lo, tp + lo, pp + lo, hi - lo, w, part + job * NumStats);
+        }
+    });
+
+    stats = partial.view({B, chunks, NumStats}).sum(1); // [B,4]
+}
+
+// Same math with tensor ops, for CUDA and non-float inputs (still one sigmoid)
+void forwardGeneric(const torch::Tensor& x, const torch::Tensor& t, double posWeight,
+                    torch::Tensor& probs, torch::Tensor& stats) {
+    probs = torch::sigmoid(x);
+    auto logWeight = 1.0 + (posWeight - 1.0) * t;
+    auto bce = (1.0 - t) * x + logWeight * (torch::log1p(torch::exp(-x.abs())) + torch::clamp_min(-x, 0));
+    stats = torch::stack({bce.sum(1), (probs * t).sum(1), probs.sum(1), t.sum(1)}, 1).to(torch::kDouble);
+}
+
+// Backward on CPU floats: dL/dx = g_b * [ ((1-t)p - w t (1-p)) / n + dDice/dp * p(1-p) ]
+torch::Tensor backwardCPU(const torch::Tensor& probs, const torch::Tensor& t, const torch::Tensor& stats,
+                          const torch::Tensor& gradOut, double posWeight) {
+    const int64_t B = probs.size(0);
+    const int64_t n = probs.size(1);
+    const int64_t chunks = (n + kChunk - 1) / kChunk;
+    const float w = static_cast<float>(posWeight);
+
+    auto grad = torch::empty_like(probs);
+    auto go = gradOut.to(torch::kDouble).contiguous();
+    auto st = stats.contiguous();
+
+    const float* pp = probs.data_ptr<float>();
+    const float* tp = t.data_ptr<float>();
+    const double* gop = go.data_ptr<double>();
+    const double* sp = st.data_ptr<double>();
+    float* gp = grad.data_ptr<float>();
+
+    const auto& kernels = chunkKernels();
+    at::parallel_for(0, B * chunks, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t job = begin; job < end; ++job) {
+            const int64_t b = job / chunks, c = job % chunks;
+            const int64_t lo = b * n + c * kChunk;
+            const int64_t hi = b * n + std::min(n, (c + 1) * kChunk);
+
+            const double u = sp[b * NumStats + PredSum] + sp[b * NumStats + TargetSum] + kDiceEps;
+            const float g = static_cast<float>(gop[b]);
+            const float bceScale = g / static_cast<float>(n);
+            // dDice/dp_i = -2 (t_i u - I) / u^2 = diceA * t_i + diceB
+            const float diceA = static_cast<float>(-2.0 / u) * g;
+            const float diceB = static_cast<float>(2.0 * sp[b * NumStats + Inter] / (u * u)) * g;
+            kernels.backward(pp + lo, tp + lo, gp + lo, hi - lo, w, bceScale, diceA, diceB);
+        }
+    });
+    return grad;
+}
+
+torch::Tensor backwardGeneric(const torch::Tensor& probs, const torch::Tensor& t, const torch::Tensor& stats,
+                              const torch::Tensor& gradOut, double posWeight) {
+    const double n = static_cast<double>(probs.size(1));
+    auto go = gradOut.to(probs.dtype()).unsqueeze(1);                   // [B,1]
+    auto st = stats.to(probs.dtype());
+    auto u = (st.select(1, PredSum) + st.select(1, TargetSum) + kDiceEps).unsqueeze(1);
+    auto inter = st.select(1, Inter).unsqueeze(1);
+    auto dBce = (1.0 - t) * probs - posWeight * t * (1.0 - probs);
+    auto dDice = -2.0 * (t * u - inter) / (u * u);
+    return go * (dBce / n + dDice * probs * (1.0 - probs));
+}
+
+class BceDiceFunction : public torch::autograd::Function<BceDiceFunction> {
+public:
+    static torch::Tensor forward(torch::autograd::AutogradContext* ctx,
+                                 const torch::Tensor& logits, const torch::Tensor& targets, double posWeight) {
+        const int64_t B = logits.size(0);
+        auto x = logits.reshape({B, -1}).contiguous();
+        auto t = targets.to(x.dtype()).reshape({B, -1}).contiguous();
+
+        torch::Tensor probs, stats;
+        if (x.device().is_cpu() && x.scalar_type() == torch::kFloat) {
+            forwardCPU(x, t, posWeight, probs, stats);
+        } else {
+            forwardGeneric(x, t, posWeight, probs, stats);
+        }
+
+        ctx->save_for_backward({probs, t, stats});
+        ctx->saved_data["pos_weight"] = posWeight;
+        ctx->saved_data["shape"] = logits.sizes().vec();
+
+        const double n = static_cast<double>(x.size(1));
+        auto bce = stats.select(1, BceSum) / n;
+        auto dice = 1.0 - 2.0 * stats.select(1, Inter)
+                    / (stats.select(1, PredSum) + stats.select(1, TargetSum) + kDiceEps);
+        return (bce + dice).to(x.options()); // [B]
+    }
+
+    static torch::autograd::variable_list backward(torch::autograd::AutogradContext* ctx,
+                                                   torch::autograd::variable_list gradOutputs) {
+        auto saved = ctx->get_saved_variables();
+        const auto& probs = saved[0];
+        const auto& t = saved[1];
+        const auto& stats = saved[2];
+        double posWeight = ctx->saved_data["pos_weight"].toDouble();
+        auto shape = ctx->saved_data["shape"].toIntVector();
+
+        torch::Tensor grad;
+        if (probs.device().is_cpu() && probs.scalar_type() == torch::kFloat) {
+            grad = backwardCPU(probs, t, stats, gradOutputs[0], posWeight);
+        } else {
+            grad = backwardGeneric(probs, t, stats, gradOutputs[0], posWeight);
+        }
+        return {grad.view(shape), torch::Tensor(), torch::Tensor()};
+    }
+};
+
+} // namespace
+
+torch::Tensor med::loss::bceDiceLossPerSample(const torch::Tensor& logits, const torch::Tensor& targets, double posWeight) {
+    if (logits.dim() < 2 || !logits.sizes().equals(targets.sizes())) {
+        throw med::error::DataProcessingException("bceDiceLoss", "logits and targets must have the same [B,...] shape");
+    }
+    return BceDiceFunction::apply(logits, targets, posWeight);
+}
+
+torch::Tensor med::loss::bceDiceLoss(const torch::Tensor& logits, const torch::Tensor& targets, double posWeight) {
+    return bceDiceLossPerSample(logits, targets, posWeight).mean();
+}
+
+torch::Tensor med::loss::distillationLossPerSample(const torch::Tensor& student, const torch::Tensor& teacher, double temperature) {
+    if (student.dim() < 2 || !student.sizes().equals(teacher.sizes())) {
+        throw med::error::DataProcessingException("distillationLoss", "student and teacher outputs must have the same [B,...] shape");
+    }
+    auto s = student / temperature;
+    auto t = teacher.detach().to(student.dtype()) / temperature;
+    torch::Tensor perSample;
+    if (student.dim() == 2) {
+        auto logP = torch::log_softmax(s, 1);
+        auto logQ = torch::log_softmax(t, 1);
+        perSample = (logQ.exp() * (logQ - logP)).sum(1);
+    } else {
+        perSample = torch::binary_cross_entropy_with_logits(s, torch::sigmoid(t), {}, {}, at::Reduction::None)
+                        .flatten(1).mean(1);
+    }
+    return perSample * (temperature * temperature);
+}
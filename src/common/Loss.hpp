@@ -9,6 +9,20 @@ namespace loss {
 // Dice loss function
 torch::Tensor diceLoss(torch::Tensor preds, torch::Tensor targets);
 
+// Fused weighted BCE-with-logits + soft Dice, per sample.
+// The sigmoid is computed once and the BCE, intersection and sum terms of every sample
+// are reduced in a single pass over the logits; the backward pass is hand-written.
+// Returns a [B] tensor: mean weighted BCE of each sample + (1 - Dice) of each sample.
+torch::Tensor bceDiceLossPerSample(const torch::Tensor& logits, const torch::Tensor& targets, double posWeight);
+
+// Batch mean of bceDiceLossPerSample
+torch::Tensor bceDiceLoss(const torch::Tensor& logits, const torch::Tensor& targets, double posWeight);
+
+// Knowledge distillation, per sample, against a teacher's logits softened by `temperature`
+// (scaled by T^2 so the gradient magnitude does not depend on T). [B,C] logits: KL divergence
+// of the class distributions; [B,1,H,W] maps: mean per-pixel BCE against sigmoid(teacher / T).
+torch::Tensor distillationLossPerSample(const torch::Tensor& student, const torch::Tensor& teacher, double temperature);
+
 }
 
 } // namespace med
@@ -0,0 +1,84 @@
+#include "LossKernel.hpp"
+#include <ATen/cpu/vec/vec.h>
+#include <algorithm>
+#include <cmath>
+
+#ifndef CPU_CAPABILITY
+#error "CPU_CAPABILITY must name the instruction set this file is compiled for (see CMakeLists.txt)"
+#endif
+
+namespace med {
+namespace loss {
+namespace kernel {
+namespace CPU_CAPABILITY {
+
+namespace {
+
+using Vec = at::vec::Vectorized<float>;
+
+float sumLanes(const Vec& v) {
+    float lanes[Vec::size()];
+    v.store(lanes);
+    float sum = 0.f;
+    for (float lane : lanes) sum += lane;
+    return sum;
+}
+
+} // namespace
+
+void forwardChunk(const float* x, const float* t, float* probs, int64_t n, float posWeight, double* stats) {
+    const Vec zero(0.f), one(1.f), wMinus1(posWeight - 1.f);
+    Vec bceV(0.f), interV(0.f), pSumV(0.f), tSumV(0.f);
+    int64_t i = 0;
+    for (; i + Vec::size() <= n; i += Vec::size()) {
+        const Vec xi = Vec::loadu(x + i), ti = Vec::loadu(t + i);
+        // exp(-|x|) gives both a stable sigmoid and a stable softplus
+        const Vec e = xi.abs().neg().exp();
+        const Vec q = (one + e).reciprocal(); // sigmoid(|x|)
+        const Vec p = Vec::blendv(e * q, q, xi >= zero);
+        const Vec logWeight = one + wMinus1 * ti;
+        bceV = bceV + (one - ti) * xi + logWeight * (e.log1p() + at::vec::maximum(xi.neg(), zero));
+        interV = interV + p * ti;
+        pSumV = pSumV + p;
+        tSumV = tSumV + ti;
+        p.store(probs + i);
+    }
+    float bce = sumLanes(bceV), inter = sumLanes(interV), pSum = sumLanes(pSumV), tSum = sumLanes(tSumV);
+    // Tail shorter than a vector: same math, one element at a time
+    for (; i < n; ++i) {
+        const float xi = x[i], ti = t[i];
+        const float e = std::exp(-std::abs(xi));
+        const float p = xi >= 0.f ? 1.f / (1.f + e) : e / (1.f + e);
+        const float logWeight = 1.f + (posWeight - 1.f) * ti;
+        bce += (1.f - ti) * xi + logWeight * (std::log1p(e) + std::max(-xi, 0.f));
+        inter += p * ti;
+        pSum += p;
+        tSum += ti;
+        probs[i] = p;
+    }
+    stats[BceSum] = bce;
+    stats[Inter] = inter;
+    stats[PredSum] = pSum;
+    stats[TargetSum] = tSum;
+}
+
+void backwardChunk(const float* probs, const float* t, float* grad, int64_t n, float posWeight,
+                   float bceScale, float diceA, float diceB) {
+    const Vec one(1.f), w(posWeight), scale(bceScale), a(diceA), b(diceB);
+    int64_t i = 0;
+    for (; i + Vec::size() <= n; i += Vec::size()) {
+        const Vec p = Vec::loadu(probs + i), ti = Vec::loadu(t + i);
+        const Vec dBce = (one - ti) * p - w * ti * (one - p);
+        (scale * dBce + (a * ti + b) * p * (one - p)).store(grad + i);
+    }
+    for (; i < n; ++i) {
+        const float p = probs[i], ti = t[i];
+        const float dBce = (1.f - ti) * p - posWeight * ti * (1.f - p);
+        grad[i] = bceScale * dBce + (diceA * ti + diceB) * p * (1.f - p);
+    }
+}
+
+} // namespace CPU_CAPABILITY
+} // namespace kernel
+} // namespace loss
+} // namespace med
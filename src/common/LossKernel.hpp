@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace med {
+namespace loss {
+namespace kernel {
+
+// Per-sample reduction slots: sum of weighted BCE, sum(p*t), sum(p), sum(t)
+enum Stat { BceSum = 0, Inter = 1, PredSum = 2, TargetSum = 3, NumStats = 4 };
+
+// Inner loops of the fused BCE + Dice loss on CPU floats, written with
+// at::vec::Vectorized<float>. LossKernel.cpp is compiled once per instruction set
+// (CPU_CAPABILITY: DEFAULT, plus AVX2 on x86-64 when MED_WITH_AVX2 is defined); Loss.cpp
+// calls the widest one the CPU supports.
+//   forwardChunk:  probs[i] = sigmoid(x[i]) for i < n, and the Stat sums of the range
+//   backwardChunk: grad[i] = bceScale * dBCE/dx_i + (diceA * t[i] + diceB) * p_i (1 - p_i)
+
+namespace DEFAULT {
+void forwardChunk(const float* x, const float* t, float* probs, int64_t n, float posWeight, double* stats);
+void backwardChunk(const float* probs, const float* t, float* grad, int64_t n, float posWeight,
+                   float bceScale, float diceA, float diceB);
+} // namespace DEFAULT
+
+#ifdef MED_WITH_AVX2
+namespace AVX2 {
+void forwardChunk(const float* x, const float* t, float* probs, int64_t n, float posWeight, double* stats);
+void backwardChunk(const float* probs, const float* t, float* grad, int64_t n, float posWeight,
+                   float bceScale, float diceA, float diceB);
+} // namespace AVX2
+#endif
+
+} // namespace kernel
+} // namespace loss
+} // namespace med
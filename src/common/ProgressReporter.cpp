@@ -0,0 +1,67 @@
+#include "ProgressReporter.hpp"
+#include "Runtime.hpp"
+#include "Utils.hpp"
+
+namespace med {
+namespace util {
+
+ProgressReporter::ProgressReporter(std::size_t barWidth, std::chrono::milliseconds interval)
+: barWidth(barWidth), interval(interval), worker(&ProgressReporter::run, this) {}
+
+ProgressReporter::~ProgressReporter() {
+    {
+        std::lock_guard<std::mutex> lock(waitMtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+void ProgressReporter::startEpoch(std::size_t epoch_, std::size_t totalEpochs_, std::size_t totalBatches, std::size_t batchIdx) {
+    std::lock_guard<std::mutex> lock(printMtx);
+    epoch = epoch_;
+    totalEpochs = totalEpochs_;
+    total = totalBatches;
+    current = batchIdx;
+    lastRendered = static_cast<std::size_t>(-1);
+}
+
+void ProgressReporter::update(std::size_t current_) {
+    current.store(current_, std::memory_order_relaxed);
+}
+
+void ProgressReporter::setLoss(double avgLoss_) {
+    avgLoss.store(avgLoss_, std::memory_order_relaxed);
+}
+
+void ProgressReporter::finishEpoch(double avgLoss_) {
+    std::lock_guard<std::mutex> lock(printMtx);
+    avgLoss = avgLoss_;
+    current = total.load();
+    render(true);
+}
+
+void ProgressReporter::run() {
+    common::Runtime::pinCurrentThread(common::ThreadRole::IO);
+    std::unique_lock<std::mutex> lock(waitMtx);
+    while (!cv.wait_for(lock, interval, [this] { return stopping; })) {
+        std::lock_guard<std::mutex> printLock(printMtx);
+        // Skip redraws when nothing moved, and leave the last bar of an epoch to finishEpoch()
+        std::size_t cur = current.load(std::memory_order_relaxed);
+        if (total == 0 || cur == lastRendered || cur >= total) continue;
+        render(false);
+    }
+}
+
+void ProgressReporter::render(bool final) {
+    std::size_t cur = current.load(std::memory_order_relaxed);
+    printProgressBar(cur, total, barWidth);
+    std::cout << "  Epoch " << epoch << "/" << totalEpochs
+              << ", Batch " << cur << "/" << total
+              << ", AvgLoss=" << avgLoss.load(std::memory_order_relaxed)
+              << (final ? "\n" : "\r") << std::flush;
+    lastRendered = cur;
+}
+
+} // namespace util
+} // namespace med
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace med {
+namespace util {
+
+// Renders the training progress bar from its own thread at a fixed rate, so the
+// training loop only publishes counters (atomic stores) and never writes to stdout.
+class ProgressReporter {
+public:
+    ProgressReporter(std::size_t barWidth, std::chrono::milliseconds interval);
+
+    // Stops the render thread
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    // Reset counters for a new epoch
+    void startEpoch(std::size_t epoch, std::size_t totalEpochs, std::size_t totalBatches, std::size_t batchIdx = 0);
+
+    // Publish the number of finished micro-batches (cheap, called every step)
+    void update(std::size_t current);
+
+    // Publish the latest average loss (whenever it has been read back from the device)
+    void setLoss(double avgLoss);
+
+    // Render the final line of the epoch
+    void finishEpoch(double avgLoss);
+
+private:
+    void run();
+    void render(bool final);
+
+    std::size_t barWidth;
+    std::chrono::milliseconds interval;
+
+    std::atomic<std::size_t> epoch{0}, totalEpochs{0}, current{0}, total{0};
+    std::atomic<double> avgLoss{0.0};
+    std::size_t lastRendered = static_cast<std::size_t>(-1);
+
+    std::mutex printMtx;               // serializes rendering between threads
+    std::mutex waitMtx;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread worker;
+};
+
+} // namespace util
+} // namespace med
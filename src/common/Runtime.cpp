@@ -0,0 +1,204 @@
+#include "Runtime.hpp"
+#include "Exception.hpp"
+#include <ATen/Parallel.h>
+#include <opencv2/core.hpp>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace med {
+namespace common {
+
+namespace {
+
+// Cores of each ThreadRole, filled once by Runtime::configure()
+std::array<std::vector<int>, 4> roleCores;
+
+std::vector<int>& coresOf(ThreadRole role) {
+    return roleCores[static_cast<size_t>(role)];
+}
+
+#ifdef __linux__
+constexpr int kMpolPreferred = 1; // MPOL_PREFERRED (linux/mempolicy.h)
+
+bool setAffinity(const std::vector<int>& cores) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cores) {
+        if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+std::vector<int> getAffinity() {
+    std::vector<int> cores;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) return cores;
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &set)) cores.push_back(c);
+    }
+    return cores;
+}
+
+// Prefer allocating pages on `node`; inherited by every thread created afterwards
+bool preferNode(int node) {
+    constexpr int kBits = 8 * sizeof(unsigned long);
+    unsigned long mask[1024 / kBits] = {};
+    if (node < 0 || node >= 1024) return false;
+    mask[node / kBits] |= 1UL << (node % kBits);
+    return syscall(SYS_set_mempolicy, kMpolPreferred, mask, sizeof(mask) * 8) == 0;
+}
+#else
+bool setAffinity(const std::vector<int>&) { return false; }
+std::vector<int> getAffinity() { return {}; }
+bool preferNode(int) { return false; }
+#endif
+
+std::string describe(const std::vector<int>& cores) {
+    if (cores.empty()) return "any";
+    std::ostringstream os;
+    os << cores.front() << ".." << cores.back() << " (" << cores.size() << " cores)";
+    return os.str();
+}
+
+} // namespace
+
+std::vector<int> Runtime::parseCpuList(const std::string& list) {
+    std::vector<int> cores;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item.empty()) continue;
+        try {
+            size_t dash = item.find('-');
+            int lo = std::stoi(item.substr(0, dash));
+            int hi = dash == std::string::npos ? lo : std::stoi(item.substr(dash + 1));
+            if (lo < 0 || hi < lo) throw std::invalid_argument(item);
+            for (int c = lo; c <= hi; ++c) cores.push_back(c);
+        } catch (const std::exception&) {
+            throw error::ConfigException("CPU list", "invalid entry '" + item + "' in '" + list + "'");
+        }
+    }
+    return cores;
+}
+
+std::vector<int> Runtime::numaNodeCpus(int node) {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    if (!in || !std::getline(in, list)) return {};
+    return parseCpuList(list);
+}
+
+void Runtime::configure(const Config& cfg) {
+    coresOf(ThreadRole::Compute) = parseCpuList(cfg.computeCores);
+    coresOf(ThreadRole::Loader) = parseCpuList(cfg.loaderCores);
+    coresOf(ThreadRole::IO) = parseCpuList(cfg.ioCores);
+    coresOf(ThreadRole::Video) = parseCpuList(cfg.videoCores);
+
+    // NUMA: compute defaults to the node's cores, and pages are preferably allocated there
+    if (cfg.numaNode >= 0) {
+        auto nodeCpus = numaNodeCpus(cfg.numaNode);
+        if (nodeCpus.empty()) {
+            std::cerr << "[WARN] NUMA node " << cfg.numaNode << " not found; not binding.\n";
+        } else {
+            if (coresOf(ThreadRole::Compute).empty()) coresOf(ThreadRole::Compute) = nodeCpus;
+            if (!preferNode(cfg.numaNode)) {
+                std::cerr << "[WARN] Could not set the NUMA memory policy for node " << cfg.numaNode << "\n";
+            }
+        }
+    }
+
+    // The inter-op pool can only be sized before its first use
+    if (cfg.interOpThreads > 0) {
+        at::set_num_interop_threads(cfg.interOpThreads);
+    }
+
+    const auto& compute = coresOf(ThreadRole::Compute);
+    if (!compute.empty() && !setAffinity(compute)) {
+        std::cerr << "[WARN] Could not pin compute threads to cores " << describe(compute) << "\n";
+    }
+
+    // Intra-op threads default to one per compute core when cores are given
+    int intraOp = cfg.intraOpThreads > 0 ? cfg.intraOpThreads : static_cast<int>(compute.size());
+    if (intraOp > 0) {
+        setIntraOpThreads(intraOp);
+    }
+    if (cfg.cvThreads >= 0) {
+        cv::setNumThreads(cfg.cvThreads);
+    }
+
+    std::cout << "[INFO] Threads: intra-op " << at::get_num_threads()
+              << ", inter-op " << at::get_num_interop_threads()
+              << ", OpenCV " << cv::getNumThreads()
+              << ", loader workers " << cfg.loaderWorkers
+              << "; compute cores " << describe(compute) << "\n";
+}
+
+void Runtime::setIntraOpThreads(int numThreads) {
+    at::set_num_threads(numThreads);
+
+    // Give each intra-op worker its own core, then widen the calling thread again so
+    // threads it creates later inherit the whole set. parallel_for alone does not promise
+    // one work item per pool thread, so every item waits at a barrier until all of them
+    // have started: the items then necessarily run on distinct threads, and each thread
+    // pins itself to the core of its arrival slot.
+    const auto& compute = coresOf(ThreadRole::Compute);
+    if (compute.empty() || at::in_parallel_region()) return;
+    const int threads = at::get_num_threads();
+    std::mutex mtx;
+    std::condition_variable cv;
+    int arrived = 0;
+    bool complete = true;
+    at::parallel_for(0, threads, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t k = begin; k < end; ++k) {
+            std::unique_lock<std::mutex> lock(mtx);
+            setAffinity({compute[static_cast<size_t>(arrived++) % compute.size()]});
+            cv.notify_all();
+            // Bounded wait: a backend that runs fewer threads than items must not hang us
+            if (!cv.wait_for(lock, std::chrono::seconds(1), [&] { return arrived >= threads; })) {
+                complete = false;
+            }
+        }
+    });
+    if (!complete) {
+        std::cerr << "[WARN] Not every intra-op thread could be pinned to its own core\n";
+    }
+    setAffinity(compute);
+}
+
+size_t Runtime::computeCoreCount() {
+    return coresOf(ThreadRole::Compute).size();
+}
+
+void Runtime::pinCurrentThread(ThreadRole role) {
+    const auto& cores = coresOf(role);
+    if (cores.empty()) return;
+    if (!setAffinity(cores)) {
+        std::cerr << "[WARN] Could not pin thread to cores " << describe(cores) << "\n";
+    }
+}
+
+ScopedAffinity::ScopedAffinity(ThreadRole role) {
+    if (coresOf(role).empty()) return;
+    previous = getAffinity();
+    Runtime::pinCurrentThread(role);
+}
+
+ScopedAffinity::~ScopedAffinity() {
+    if (!previous.empty()) setAffinity(previous);
+}
+
+} // namespace common
+} // namespace med
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ArgParser.hpp"
+#include <string>
+#include <vector>
+
+namespace med {
+namespace common {
+
+// Kinds of threads that can be pinned to their own cores
+enum class ThreadRole { Compute, Loader, IO, Video };
+
+// Process-wide threading setup: libtorch/OpenCV thread counts, per-role CPU affinity
+// and NUMA-local allocation. Linux only for pinning/NUMA; elsewhere those are no-ops.
+class Runtime {
+public:
+    // Apply cfg's thread counts, memory policy and compute pinning.
+    // Call once at startup, before any libtorch work and before other threads exist
+    // (threads inherit the affinity and memory policy of their creator).
+    static void configure(const Config& cfg);
+
+    // Resize the intra-op pool; with compute cores configured, each worker is pinned to its own core
+    static void setIntraOpThreads(int numThreads);
+
+    // Number of compute cores configured (0 = not pinned)
+    static size_t computeCoreCount();
+
+    // Pin the calling thread to the cores configured for `role` (no-op when none are set)
+    static void pinCurrentThread(ThreadRole role);
+
+    // Parse a Linux-style CPU list ("0-3,8,10-11")
+    static std::vector<int> parseCpuList(const std::string& list);
+
+    // CPU list of NUMA node `node`, read from sysfs (empty if unknown)
+    static std::vector<int> numaNodeCpus(int node);
+};
+
+// Pins the calling thread to a role's cores for its lifetime, then restores the old
+// affinity. Useful around calls that spawn helper threads (e.g. opening a video encoder).
+class ScopedAffinity {
+public:
+    explicit ScopedAffinity(ThreadRole role);
+    ~ScopedAffinity();
+
+    ScopedAffinity(const ScopedAffinity&) = delete;
+    ScopedAffinity& operator=(const ScopedAffinity&) = delete;
+
+private:
+    std::vector<int> previous;
+};
+
+} // namespace common
+} // namespace med
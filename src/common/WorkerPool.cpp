@@ -0,0 +1,39 @@
+#include "WorkerPool.hpp"
+
+namespace med {
+namespace common {
+
+WorkerPool::WorkerPool(size_t numThreads, std::function<void()> onStart) {
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers.emplace_back(&WorkerPool::run, this, onStart);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+void WorkerPool::run(const std::function<void()>& onStart) {
+    if (onStart) onStart();
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        cv.wait(lock, [this] { return !jobs.empty() || stopping; });
+        if (jobs.empty()) break; // stopping with nothing queued
+
+        auto job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+        job(); // packaged_task captures exceptions into the future
+        lock.lock();
+    }
+}
+
+} // namespace common
+} // namespace med
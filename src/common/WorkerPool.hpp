@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace med {
+namespace common {
+
+// Fixed-size pool of worker threads running submitted jobs in FIFO order
+class WorkerPool {
+public:
+    // `onStart` runs once on every worker before it takes jobs (e.g. to pin it to cores)
+    explicit WorkerPool(size_t numThreads, std::function<void()> onStart = {});
+
+    // Finishes the queued jobs, then joins the workers
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Queue `job`; its result (or exception) is delivered through the returned future
+    template <class F>
+    auto submit(F&& job) -> std::future<std::invoke_result_t<F>> {
+        using Result = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        auto result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            jobs.emplace_back([task] { (*task)(); });
+        }
+        cv.notify_one();
+        return result;
+    }
+
+    size_t size() const { return workers.size(); }
+
+private:
+    void run(const std::function<void()>& onStart);
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+};
+
+} // namespace common
+} // namespace med
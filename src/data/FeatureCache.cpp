@@ -0,0 +1,114 @@
+#include "FeatureCache.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace med {
+namespace data {
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'E', 'D', 'F', 'E', 'A', 'T', '1'};
+
+struct Header {
+    char magic[8];
+    uint64_t count;
+    uint64_t dim;
+    uint64_t fingerprint;
+};
+static_assert(sizeof(Header) == 32, "FeatureCache header must stay 32 bytes");
+
+} // namespace
+
+size_t FeatureCache::labelsOffset(int64_t count, int64_t dim) {
+    size_t end = sizeof(Header) + static_cast<size_t>(count * dim) * sizeof(float);
+    return (end + 7) & ~size_t(7);
+}
+
+void FeatureCache::write(const std::string& path, const torch::Tensor& features,
+                         const torch::Tensor& labels, uint64_t fingerprint) {
+    if (features.dim() != 2 || labels.dim() != 1 || features.size(0) != labels.size(0)) {
+        throw error::DataProcessingException("FeatureCache", "expected features [N,D] and labels [N]");
+    }
+    auto feats = features.to(torch::kCPU, torch::kFloat).contiguous();
+    auto labs = labels.to(torch::kCPU, torch::kLong).contiguous();
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.count = static_cast<uint64_t>(feats.size(0));
+    header.dim = static_cast<uint64_t>(feats.size(1));
+    header.fingerprint = fingerprint;
+
+    // Written next to the target and renamed, so a crash never leaves a torn cache behind
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw error::FileIOException(tmp, false);
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(feats.data_ptr<float>()), feats.numel() * sizeof(float));
+        size_t pad = labelsOffset(feats.size(0), feats.size(1)) - sizeof(header) - feats.numel() * sizeof(float);
+        const char zeros[8] = {};
+        out.write(zeros, pad);
+        out.write(reinterpret_cast<const char*>(labs.data_ptr<int64_t>()), labs.numel() * sizeof(int64_t));
+        if (!out) {
+            throw error::FileIOException(tmp, false);
+        }
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+FeatureCache::FeatureCache(const std::string& path_) : path(path_) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw error::FileIOException(path, true);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        throw error::DataProcessingException("FeatureCache", path + " is truncated");
+    }
+    bytes = static_cast<size_t>(st.st_size);
+    data = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        throw error::FileIOException(path, true);
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    count = static_cast<int64_t>(header.count);
+    dim_ = static_cast<int64_t>(header.dim);
+    fingerprint_ = header.fingerprint;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        bytes < labelsOffset(count, dim_) + static_cast<size_t>(count) * sizeof(int64_t)) {
+        ::munmap(data, bytes);
+        data = nullptr;
+        throw error::DataProcessingException("FeatureCache", path + " is not a valid feature cache");
+    }
+    // Head training walks the rows in random order
+    ::madvise(data, bytes, MADV_WILLNEED);
+}
+
+FeatureCache::~FeatureCache() {
+    if (data) ::munmap(data, bytes);
+}
+
+torch::Tensor FeatureCache::features() const {
+    auto* base = static_cast<char*>(data) + sizeof(Header);
+    return torch::from_blob(base, {count, dim_}, torch::kFloat);
+}
+
+torch::Tensor FeatureCache::labels() const {
+    auto* base = static_cast<char*>(data) + labelsOffset(count, dim_);
+    return torch::from_blob(base, {count}, torch::kLong);
+}
+
+} // namespace data
+} // namespace med
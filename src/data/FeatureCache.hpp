@@ -0,0 +1,48 @@
+#pragma once
+
+#include "common/Exception.hpp"
+#include <torch/torch.h>
+#include <cstdint>
+#include <string>
+
+namespace med {
+namespace data {
+
+// Pooled backbone embeddings + labels of a whole dataset, stored in one flat file and
+// memory-mapped for head-only training. Layout: 32-byte header (magic "MEDFEAT1", count,
+// dim, fingerprint), float32 features [count, dim], int64 labels [count] (8-byte aligned).
+class FeatureCache {
+public:
+    // Write features [N,D] and labels [N] to `path` (via a temporary file + rename)
+    static void write(const std::string& path, const torch::Tensor& features,
+                      const torch::Tensor& labels, uint64_t fingerprint);
+
+    // Map an existing cache file read-only
+    explicit FeatureCache(const std::string& path);
+    ~FeatureCache();
+
+    FeatureCache(const FeatureCache&) = delete;
+    FeatureCache& operator=(const FeatureCache&) = delete;
+
+    // Zero-copy views into the mapping; valid while this object lives, never write to them
+    torch::Tensor features() const;
+    torch::Tensor labels() const;
+
+    // Identifies the backbone weights and sample list the cache was built from
+    uint64_t fingerprint() const { return fingerprint_; }
+    int64_t size() const { return count; }
+    int64_t dim() const { return dim_; }
+
+private:
+    // Byte offset of the label array
+    static size_t labelsOffset(int64_t count, int64_t dim);
+
+    std::string path;
+    void* data = nullptr; // mapping base
+    size_t bytes = 0;     // mapping length
+    int64_t count = 0, dim_ = 0;
+    uint64_t fingerprint_ = 0;
+};
+
+} // namespace data
+} // namespace med
@@ -1,15 +1,22 @@
 #include "ImageLoader.hpp"
+#include <algorithm>
+#include <functional>
+#include <thread>
 
 namespace med {
 namespace data {
 
-ImageLoader::ImageLoader(const std::string& imageDir, const cv::Size& targetSize)
-    : rootDir(imageDir), targetSize(targetSize)
+ImageLoader::ImageLoader(const std::string& imageDir, const cv::Size& targetSize, const std::vector<cv::Size>& extraSizes)
+    : rootDir(imageDir), targetSize(targetSize), sizes{targetSize}
 {
-    // Cache directory will be "rootDir/cache"
+    // Cache directory will be "rootDir/cache", one "WxH" subdirectory per resolution
     cacheDir = rootDir + "/cache";
-    if (!fs::exists(cacheDir)) {
-        fs::create_directories(cacheDir);
+    for (const auto& s : extraSizes) {
+        if (std::find(sizes.begin(), sizes.end(), s) != sizes.end()) continue;
+        sizes.push_back(s);
+    }
+    for (const auto& s : sizes) {
+        fs::create_directories(fs::path(cacheFile("x", s)).parent_path());
     }
 }
 
@@ -23,9 +30,13 @@ cv::Mat ImageLoader::loadRaw(const std::string& filePath) const {
 }
 
 torch::Tensor ImageLoader::process(const cv::Mat& img) const {
+    return process(img, targetSize);
+}
+
+torch::Tensor ImageLoader::process(const cv::Mat& img, const cv::Size& size) const {
     cv::Mat resized, gray, thresh;
     try {
-        cv::resize(img, resized, targetSize);
+        cv::resize(img, resized, size);
         cv::cvtColor(resized, gray, cv::COLOR_BGR2GRAY);
         // Apply Otsu thresholding to obtain a binary image
         cv::threshold(gray, thresh, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
@@ -39,32 +50,73 @@ torch::Tensor ImageLoader::process(const cv::Mat& img) const {
 }
 
 torch::Tensor ImageLoader::loadCached(const std::string& filePath) {
-    fs::path p(filePath);
-    std::string cacheFile = cacheDir + "/" + p.stem().string() + ".pt";
+    return loadCached(filePath, targetSize);
+}
 
+torch::Tensor ImageLoader::loadCached(const std::string& filePath, const cv::Size& size) {
     // If cached image exists, load it; otherwise, process it and cache it.
-    if (fs::exists(cacheFile)) {
+    std::string file = cacheFile(filePath, size);
+    if (fs::exists(file)) {
         torch::Tensor tensor;
-        torch::load(tensor, cacheFile);
+        torch::load(tensor, file);
         return tensor;
-    } else {
-        cv::Mat raw = loadRaw(filePath);
-        if (raw.empty()) {
-            throw med::error::FileIOException(cacheFile, true);
-        }
-        torch::Tensor processed = process(raw);
-        cache(filePath, processed);
-        return processed;
     }
+
+    // Decode once, fill every missing resolution
+    cv::Mat raw = loadRaw(filePath);
+    torch::Tensor requested;
+    for (const auto& s : sizes) {
+        std::string f = cacheFile(filePath, s);
+        if (s != size && fs::exists(f)) continue;
+        torch::Tensor processed = process(raw, s);
+        if (s == size) requested = processed;
+        saveAtomic(processed, f);
+    }
+    // A size outside the cached set is served without caching
+    return requested.defined() ? requested : process(raw, size);
 }
 
-void ImageLoader::cache(const std::string& filePath, const torch::Tensor& tensor) const {
+torch::Tensor ImageLoader::loadNative(const std::string& filePath) {
+    std::string file = cacheFile(filePath, std::string("native"));
+    if (fs::exists(file)) {
+        torch::Tensor tensor;
+        torch::load(tensor, file);
+        return tensor;
+    }
+    cv::Mat raw = loadRaw(filePath);
+    torch::Tensor processed = process(raw, raw.size());
+    saveAtomic(processed, file);
+    return processed;
+}
+
+std::string ImageLoader::cacheFile(const std::string& filePath, const cv::Size& size) const {
+    // Keyed by resolution, so a run with another --image-size never reads stale tensors
+    return cacheFile(filePath, std::to_string(size.width) + "x" + std::to_string(size.height));
+}
+
+std::string ImageLoader::cacheFile(const std::string& filePath, const std::string& subdir) const {
+    // Subdirectories of filePath are kept (class folders may repeat file names)
     fs::path p(filePath);
-    std::string cacheFile = cacheDir + "/" + p.stem().string() + ".pt";
+    fs::path key = p.parent_path() / p.stem();
+    return cacheDir + "/" + subdir + "/" + key.string() + ".pt";
+}
+
+void ImageLoader::cache(const std::string& filePath, const torch::Tensor& tensor) const {
+    saveAtomic(tensor, cacheFile(filePath, targetSize));
+}
+
+void ImageLoader::saveAtomic(const torch::Tensor& tensor, const std::string& file) const {
+    // Loader workers and the validator share the cache: each writer uses its own temporary
+    // name and renames it into place, so a reader never sees a partially written file
+    std::string tmp = file + ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
     try {
-        torch::save(tensor, cacheFile);
-    } catch (const c10::Error& e) {
-        throw med::error::FileIOException(cacheFile, false);
+        fs::create_directories(fs::path(file).parent_path());
+        torch::save(tensor, tmp);
+        fs::rename(tmp, file);
+    } catch (const std::exception&) {
+        std::error_code ec;
+        fs::remove(tmp, ec);
+        throw med::error::FileIOException(file, false);
     }
 }
 
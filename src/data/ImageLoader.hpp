@@ -6,6 +6,7 @@
 #include <string>
 #include <iostream>
 #include <filesystem>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -14,8 +15,8 @@ namespace data {
 
 class ImageLoader {
 public:
-    // Constructor 
-    ImageLoader(const std::string& imageDir, const cv::Size& targetSize);
+    // Constructor; extraSizes are further resolutions kept in the cache (progressive resizing)
+    ImageLoader(const std::string& imageDir, const cv::Size& targetSize, const std::vector<cv::Size>& extraSizes = {});
 
     // Loads raw image from given path (relative to imageDir) and returns a cv::Mat
     cv::Mat loadRaw(const std::string& filePath) const;
@@ -23,9 +24,20 @@ public:
     // Processes image (resize, convert to grayscale, threshold) and convert to torch::Tensor
     torch::Tensor process(const cv::Mat& img) const;
 
+    // Same, at an explicit size
+    torch::Tensor process(const cv::Mat& img, const cv::Size& size) const;
+
     // Loads processed image as tensor (if a cache version exists, load it, otherwise process it and save)
     torch::Tensor loadCached(const std::string& filePath);
 
+    // Loads the processed image at `size` from the multi-resolution cache. On a miss the
+    // image is decoded once and cached at every size of the loader.
+    torch::Tensor loadCached(const std::string& filePath, const cv::Size& size);
+
+    // Loads the processed image at the resolution it is stored in (crop training), cached
+    // under cacheDir/native/
+    torch::Tensor loadNative(const std::string& filePath);
+
     // Save processed tensor in a cache file
     void cache(const std::string& filePath, const torch::Tensor& tensor) const;
 
@@ -45,9 +57,19 @@ public:
     }
 
 private:
+    // Cache file of `filePath` at `size`: cacheDir/WxH/<subdirectories>/<stem>.pt
+    std::string cacheFile(const std::string& filePath, const cv::Size& size) const;
+
+    // Same, under cacheDir/<subdir>/
+    std::string cacheFile(const std::string& filePath, const std::string& subdir) const;
+
+    // torch::save to a temporary file renamed over `file` (safe with concurrent loaders)
+    void saveAtomic(const torch::Tensor& tensor, const std::string& file) const;
+
     std::string rootDir;   // Directory from which images are loaded
     cv::Size targetSize;   // Target dimension for the resizing step
     std::string cacheDir;  // Directory for processed images caching
+    std::vector<cv::Size> sizes; // Cached resolutions, targetSize first
 };
 
 } // namespace data
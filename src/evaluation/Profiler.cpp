@@ -0,0 +1,103 @@
+#include "Profiler.hpp"
+#include <ATen/record_function.h>
+#include <c10/core/Allocator.h>
+#include <c10/util/ThreadLocalDebugInfo.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_set>
+
+namespace med {
+namespace eval {
+
+namespace {
+
+// Multiply-adds seen by the observer on this thread
+thread_local double observedMacs = 0.0;
+
+std::unique_ptr<at::ObserverContext> onOpStart(const at::RecordFunction&) {
+    return nullptr;
+}
+
+void onOpEnd(const at::RecordFunction& fn, at::ObserverContext*) {
+    const char* op = fn.name();
+    auto inputs = fn.inputs();
+    const auto& outputs = fn.outputs();
+    if (inputs.size() < 2 || !inputs[0].isTensor() || !inputs[1].isTensor() ||
+        outputs.empty() || !outputs[0].isTensor()) {
+        return;
+    }
+    const auto& weight = inputs[1].toTensor();
+    const auto& out = outputs[0].toTensor();
+
+    if (std::strcmp(op, "aten::convolution") == 0) {
+        // weight: [out, in/groups, k...] or, transposed, [in, out/groups, k...]
+        int64_t kernel = 1;
+        for (int64_t d = 2; d < weight.dim(); ++d) kernel *= weight.size(d);
+        bool transposed = inputs.size() > 6 && inputs[6].isBool() && inputs[6].toBool();
+        int64_t elements = transposed ? inputs[0].toTensor().numel() : out.numel();
+        observedMacs += static_cast<double>(elements) * weight.size(1) * kernel;
+    } else if (std::strcmp(op, "aten::linear") == 0) {
+        observedMacs += static_cast<double>(out.numel()) * weight.size(1);
+    }
+}
+
+// Receives every allocation and free of this thread while installed as profiler state
+struct AllocationCounter : public c10::MemoryReportingInfoBase {
+    int64_t allocations = 0;
+    int64_t current = 0, peak = 0; // bytes, relative to the start of the pass
+
+    void reportMemoryUsage(void*, int64_t allocSize, size_t, size_t, c10::Device) override {
+        if (allocSize > 0) ++allocations;
+        current += allocSize;
+        peak = std::max(peak, current);
+    }
+    bool memoryProfilingEnabled() const override { return true; }
+};
+
+} // namespace
+
+ModelProfile Profiler::profile(models::BaseModel& model, const std::vector<int64_t>& inputShape,
+                               torch::Device device, torch::MemoryFormat format, int runs) {
+    ModelProfile result;
+    std::unordered_set<const void*> seen; // DenseBlock registers its layers twice
+    for (const auto& p : model.parameters()) {
+        if (seen.insert(p.unsafeGetTensorImpl()).second) result.params += p.numel();
+    }
+
+    const bool wasTraining = model.is_training();
+    model.eval();
+    {
+        torch::InferenceMode guard;
+        auto input = torch::rand(inputShape, torch::TensorOptions().device(device)).contiguous(format);
+
+        // Counted pass (doubles as warm-up: allocations, kernel selection)
+        observedMacs = 0.0;
+        auto handle = at::addThreadLocalCallback(
+            at::RecordFunctionCallback(&onOpStart, &onOpEnd).needsInputs(true).needsOutputs(true));
+        model.predict(input).sum().item<double>();
+        at::removeCallback(handle);
+        result.gflops = 2.0 * observedMacs / 1e9;
+
+        // Memory of one pass, after the warm-up above has settled caches and plans
+        {
+            auto counter = std::make_shared<AllocationCounter>();
+            c10::DebugInfoGuard guard(c10::DebugInfoKind::PROFILER_STATE, counter);
+            model.predict(input);
+            result.allocations = counter->allocations;
+            result.peakMB = counter->peak / (1024.0 * 1024.0);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        torch::Tensor out;
+        for (int i = 0; i < runs; ++i) out = model.predict(input);
+        out.sum().item<double>(); // wait for queued device work
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.latencyMs = ms / std::max(1, runs);
+    }
+    model.train(wasTraining);
+    return result;
+}
+
+} // namespace eval
+} // namespace med
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "models/BaseModel.hpp"
+#include <iostream>
+#include <torch/torch.h>
+#include <vector>
+
+namespace med {
+namespace eval {
+
+// Cost of one forward pass of a model
+struct ModelProfile {
+    int64_t params = 0;     // distinct parameter elements
+    double gflops = 0.0;    // 2 x multiply-adds of all convolutions and linear layers
+    double latencyMs = 0.0; // mean wall time per forward pass
+    int64_t allocations = 0; // tensor allocations of one (warm) forward pass
+    double peakMB = 0.0;     // peak of the memory allocated during that pass
+
+    friend std::ostream& operator<<(std::ostream& os, const ModelProfile& p) {
+        os << "params " << p.params << ", " << p.gflops << " GFLOPs, " << p.latencyMs << " ms/forward";
+        return os;
+    }
+};
+
+// Measures parameters, FLOPs and latency of a model for a given input shape. FLOPs are
+// counted from the operator shapes actually executed (a RecordFunction observer on
+// aten::convolution and aten::linear), so they hold for any architecture or variant.
+// Allocations are counted through the allocator's memory-profiling hook.
+class Profiler {
+public:
+    static ModelProfile profile(models::BaseModel& model, const std::vector<int64_t>& inputShape,
+                                torch::Device device, torch::MemoryFormat format = torch::MemoryFormat::Contiguous,
+                                int runs = 10);
+};
+
+} // namespace eval
+} // namespace med
@@ -0,0 +1,51 @@
+#include "TestTimeAugmentation.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace med {
+namespace eval {
+
+int TestTimeAugmentation::usableViews(int views, int64_t height, int64_t width) {
+    views = std::clamp(views, 1, kMaxViews);
+    return height == width ? views : std::min(views, 4);
+}
+
+torch::Tensor TestTimeAugmentation::transform(const torch::Tensor& x, int view) {
+    const int64_t h = x.dim() - 2, w = x.dim() - 1;
+    torch::Tensor y = x;
+    if (view & 1) y = y.flip({w});
+    if (view & 2) y = y.flip({h});
+    if (view & 4) y = y.transpose(h, w);
+    return y;
+}
+
+torch::Tensor TestTimeAugmentation::invert(const torch::Tensor& y, int view) {
+    // Flips are their own inverse and commute; only the transpose has to be undone first
+    const int64_t h = y.dim() - 2, w = y.dim() - 1;
+    torch::Tensor x = y;
+    if (view & 4) x = x.transpose(h, w);
+    if (view & 2) x = x.flip({h});
+    if (view & 1) x = x.flip({w});
+    return x;
+}
+
+torch::Tensor TestTimeAugmentation::predict(models::BaseModel& model, const torch::Tensor& input, int views) {
+    views = usableViews(views, input.size(2), input.size(3));
+    if (views == 1) {
+        return model.predict(input);
+    }
+    std::vector<torch::Tensor> batch;
+    batch.reserve(views);
+    for (int k = 0; k < views; ++k) batch.push_back(transform(input, k));
+    auto out = model.predict(torch::cat(batch).contiguous(input.suggest_memory_format()));
+
+    // Chunk k holds view k of every image; sum them back in the input frame
+    auto chunks = out.chunk(views, 0);
+    const bool dense = out.dim() == 4;
+    torch::Tensor sum = chunks[0].clone();
+    for (int k = 1; k < views; ++k) sum.add_(dense ? invert(chunks[k], k) : chunks[k]);
+    return sum.div_(views);
+}
+
+} // namespace eval
+} // namespace med
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "models/BaseModel.hpp"
+#include <torch/torch.h>
+
+namespace med {
+namespace eval {
+
+// Flip/rotate test-time augmentation run as one batch. View k flips the width (bit 0),
+// flips the height (bit 1) and then transposes (bit 2); the 8 views are all symmetries of
+// the square. All views of a batch go through a single forward pass, and the outputs are
+// mapped back to the input frame and averaged as logits, so N views cost one N-times
+// larger batch instead of N passes.
+class TestTimeAugmentation {
+public:
+    static constexpr int kMaxViews = 8;
+
+    // Mean output of `model` over the first `views` views of `input` [B,C,H,W]. Dense
+    // outputs [B,K,H,W] are inverse-transformed first, vector outputs [B,K] averaged as
+    // they are. Views 4-7 swap height and width, so non-square inputs get at most 4.
+    static torch::Tensor predict(models::BaseModel& model, const torch::Tensor& input, int views);
+
+    // View `view` of a [.., H, W] tensor, and its inverse
+    static torch::Tensor transform(const torch::Tensor& x, int view);
+    static torch::Tensor invert(const torch::Tensor& y, int view);
+
+    // Number of views actually used for an input of the given spatial size
+    static int usableViews(int views, int64_t height, int64_t width);
+};
+
+} // namespace eval
+} // namespace med
@@ -0,0 +1,97 @@
+#include "TiledPredictor.hpp"
+#include "TestTimeAugmentation.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace med {
+namespace eval {
+
+TiledPredictor::TiledPredictor(models::BaseModel& model_, torch::Device device_, int tile_, int stride_,
+                               common::TileBlend blend, size_t batchSize_, torch::MemoryFormat format_, int views_)
+: model(model_), device(device_), tile(std::max(tile_, 16)),
+  stride(stride_ > 0 ? std::min(stride_, tile) : std::max(tile / 2, 1)),
+  batchSize(std::max<size_t>(batchSize_, 1)), format(format_), views(views_) {
+    // Separable 1-D profile, highest in the tile centre
+    auto i = torch::arange(tile, torch::kFloat) - (tile - 1) / 2.0;
+    torch::Tensor profile;
+    if (blend == common::TileBlend::Gaussian) {
+        double sigma = tile / 8.0;
+        profile = torch::exp(-(i * i) / (2 * sigma * sigma));
+    } else {
+        profile = 1.0 - i.abs() / (tile / 2.0 + 1.0);
+    }
+    // Border pixels covered by a single tile must still get a (small) positive weight
+    window = torch::outer(profile, profile).clamp_min(1e-3).to(device);
+}
+
+std::vector<int> TiledPredictor::positions(int length, int tile, int stride) {
+    std::vector<int> out;
+    for (int p = 0; p + tile < length; p += stride) out.push_back(p);
+    out.push_back(std::max(0, length - tile));
+    return out;
+}
+
+torch::Tensor TiledPredictor::runTiles(const cv::Mat& gray, const std::vector<cv::Point>& origins) {
+    auto batch = torch::empty({static_cast<int64_t>(origins.size()), 1, tile, tile});
+    for (size_t k = 0; k < origins.size(); ++k) {
+        const cv::Point& o = origins[k];
+        cv::Mat patch = gray(cv::Rect(o.x, o.y, std::min(tile, gray.cols - o.x), std::min(tile, gray.rows - o.y)));
+        if (patch.rows < tile || patch.cols < tile) {
+            cv::copyMakeBorder(patch, patch, 0, tile - patch.rows, 0, tile - patch.cols, cv::BORDER_REPLICATE);
+        }
+        // Same scaling as ImageLoader::matToTensor, written straight into the batch
+        cv::Mat dst(tile, tile, CV_32F, batch[k].data_ptr<float>());
+        patch.convertTo(dst, CV_32F, 1.0 / 255);
+    }
+    auto logits = TestTimeAugmentation::predict(model, batch.to(device).contiguous(format), views).squeeze(1);
+    return (logits * window).to(torch::kCPU, torch::kFloat);
+}
+
+cv::Mat TiledPredictor::predictMask(const cv::Mat& gray) {
+    if (gray.empty() || gray.type() != CV_8UC1) {
+        throw error::DataProcessingException("TiledPredictor", "expected an 8-bit single-channel image");
+    }
+    torch::InferenceMode inferenceMode;
+    model.eval();
+    const int H = gray.rows, W = gray.cols;
+    auto ys = positions(H, tile, stride);
+    auto xs = positions(W, tile, stride);
+    cv::Mat mask(H, W, CV_8U);
+
+    // Rolling band of image rows [top, top + tile): window-weighted logit sums. The weights
+    // are positive, so the sum has the sign of the blended (weighted mean) logit and the
+    // 0.5 probability threshold needs no normalization.
+    auto acc = torch::zeros({tile, W});
+    int top = 0;
+
+    // Rows [top, top + rows) get no further tiles: threshold them and slide the band down
+    auto flush = [&](int rows) {
+        rows = std::min(rows, H - top);
+        auto out = (acc.narrow(0, 0, rows) >= 0).to(torch::kU8).mul_(255).contiguous();
+        for (int r = 0; r < rows; ++r) {
+            std::memcpy(mask.ptr<uint8_t>(top + r), out[r].data_ptr<uint8_t>(), W);
+        }
+        acc = torch::cat({acc.narrow(0, rows, tile - rows), torch::zeros({rows, W})});
+        top += rows;
+    };
+
+    for (int y : ys) {
+        if (y > top) flush(y - top);
+        int h = std::min(tile, H - y);
+        for (size_t first = 0; first < xs.size(); first += batchSize) {
+            size_t last = std::min(xs.size(), first + batchSize);
+            std::vector<cv::Point> origins;
+            for (size_t k = first; k < last; ++k) origins.emplace_back(xs[k], y);
+            auto logits = runTiles(gray, origins);
+            for (size_t k = first; k < last; ++k) {
+                int x = xs[k], w = std::min(tile, W - x);
+                acc.narrow(0, 0, h).narrow(1, x, w).add_(logits[k - first].narrow(0, 0, h).narrow(1, 0, w));
+            }
+        }
+    }
+    flush(H - top);
+    return mask;
+}
+
+} // namespace eval
+} // namespace med
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common/ArgParser.hpp"
+#include "common/Exception.hpp"
+#include "models/BaseModel.hpp"
+#include <opencv2/opencv.hpp>
+#include <torch/torch.h>
+#include <vector>
+
+namespace med {
+namespace eval {
+
+// Sliding-window segmentation at native resolution. Overlapping tiles are predicted in
+// batches and their logits blended with a Gaussian or linear (tent) window, so seams
+// vanish and thin structures keep their full resolution. Rows of tiles are processed
+// top to bottom and only a band of `tile` rows is accumulated, so memory beyond the
+// input and output images stays O(tile * width) for any image size.
+class TiledPredictor {
+public:
+    // stride <= tile (0 = tile / 2); batchSize tiles per forward pass; `views` flip/rotate
+    // views of every tile are averaged (see TestTimeAugmentation)
+    TiledPredictor(models::BaseModel& model, torch::Device device, int tile, int stride,
+                   common::TileBlend blend, size_t batchSize,
+                   torch::MemoryFormat format = torch::MemoryFormat::Contiguous, int views = 1);
+
+    // Binary mask (CV_8U, 0/255 where the blended logit >= 0) of an 8-bit grayscale image
+    cv::Mat predictMask(const cv::Mat& gray);
+
+    // Top-left coordinates of the tiles along one axis; the last tile ends at `length`
+    static std::vector<int> positions(int length, int tile, int stride);
+
+private:
+    // Window-weighted logits [n, tile, tile] (CPU) of the tiles at `origins`; tiles
+    // overhanging the image are padded by edge replication
+    torch::Tensor runTiles(const cv::Mat& gray, const std::vector<cv::Point>& origins);
+
+    models::BaseModel& model;
+    torch::Device device;
+    int tile, stride;
+    size_t batchSize;
+    torch::MemoryFormat format;
+    int views;
+    torch::Tensor window; // [tile, tile] blending weights, on the device
+};
+
+} // namespace eval
+} // namespace med
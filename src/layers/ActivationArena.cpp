@@ -0,0 +1,150 @@
+#include "ActivationArena.hpp"
+#include "common/Exception.hpp"
+#include <algorithm>
+#include <climits>
+#include <numeric>
+
+namespace med {
+namespace layers {
+
+namespace {
+
+constexpr size_t kAlign = 64;
+
+size_t alignUp(size_t n) { return (n + kAlign - 1) & ~(kAlign - 1); }
+
+} // namespace
+
+void ActivationArena::begin(const torch::Tensor& input) {
+    std::vector<int64_t> key = input.sizes().vec();
+    key.push_back(static_cast<int64_t>(input.scalar_type()));
+    key.push_back(static_cast<int64_t>(input.device().type()));
+    key.push_back(input.device().index());
+    key.push_back(input.is_contiguous(torch::MemoryFormat::ChannelsLast));
+    current = &plans[key];
+    if (current->planned) {
+        reserve(*current); // the block may have moved to another device since
+    } else {
+        current->requests.clear(); // an earlier recording was cut short
+    }
+    next = 0;
+    event = 0;
+    live.assign(current->requests.size(), torch::Tensor());
+}
+
+torch::Tensor ActivationArena::acquire(at::IntArrayRef sizes, const torch::TensorOptions& options,
+                                       torch::MemoryFormat format) {
+    if (!current) {
+        throw error::ModelException("ActivationArena::acquire() outside begin()/end()");
+    }
+    Plan& plan = *current;
+    if (!plan.planned) {
+        // Recording: a normal allocation, remembered with its lifetime
+        Request r;
+        auto t = torch::empty(sizes, options.memory_format(format));
+        r.sizes = t.sizes().vec();
+        r.strides = t.strides().vec();
+        r.options = t.options();
+        r.bytes = t.nbytes();
+        r.first = event++;
+        plan.requests.push_back(std::move(r));
+        live.push_back(t);
+        ++next;
+        return t;
+    }
+    if (next >= plan.requests.size() || plan.requests[next].sizes != sizes.vec()) {
+        throw error::ModelException("activation request " + std::to_string(next) + " differs from the planned pass");
+    }
+    const Request& r = plan.requests[next];
+    // The deleter keeps the block alive for as long as the view is (even once it was regrown)
+    auto* base = static_cast<uint8_t*>(block.data_ptr()) + r.offset;
+    auto t = torch::from_blob(base, r.sizes, r.strides, [block = block](void*) {}, r.options);
+    live[next++] = t;
+    ++event;
+    return t;
+}
+
+void ActivationArena::release(const torch::Tensor& buffer) {
+    if (!current) return;
+    for (size_t k = 0; k < live.size(); ++k) {
+        if (live[k].defined() && live[k].is_same(buffer)) {
+            if (!current->planned) current->requests[k].last = event;
+            live[k] = torch::Tensor();
+            ++event;
+            return;
+        }
+    }
+}
+
+void ActivationArena::end() {
+    if (!current) return;
+    Plan& plan = *current;
+    live.clear();
+    current = nullptr;
+    if (plan.planned || plan.requests.empty()) return;
+
+    // Largest first: each request takes the lowest offset where it overlaps no placed
+    // request that is alive at the same time
+    auto& reqs = plan.requests;
+    std::vector<size_t> order(reqs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return reqs[a].bytes > reqs[b].bytes; });
+    auto lastUse = [](const Request& r) { return r.last < 0 ? INT_MAX : r.last; };
+
+    std::vector<size_t> placed;
+    size_t total = 0;
+    for (size_t i : order) {
+        Request& r = reqs[i];
+        std::vector<const Request*> overlapping;
+        for (size_t j : placed) {
+            const Request& p = reqs[j];
+            if (p.first <= lastUse(r) && r.first <= lastUse(p)) overlapping.push_back(&p);
+        }
+        std::sort(overlapping.begin(), overlapping.end(),
+                  [](const Request* a, const Request* b) { return a->offset < b->offset; });
+        size_t offset = 0;
+        for (const Request* p : overlapping) {
+            if (offset + r.bytes <= p->offset) break;
+            offset = std::max(offset, alignUp(p->offset + p->bytes));
+        }
+        r.offset = offset;
+        total = std::max(total, offset + r.bytes);
+        placed.push_back(i);
+    }
+    plan.bytes = std::max<size_t>(total, 1);
+    plan.planned = true;
+    reserve(plan);
+}
+
+void ActivationArena::reserve(const Plan& plan) {
+    // Views of earlier passes keep a replaced block alive until they are gone
+    auto options = plan.requests.front().options.dtype(torch::kByte);
+    if (!block.defined() || block.device() != options.device() || block.nbytes() < plan.bytes) {
+        block = torch::empty({static_cast<int64_t>(plan.bytes)}, options);
+    }
+}
+
+size_t ActivationArena::plannedBytes() const {
+    return block.defined() ? block.nbytes() : 0;
+}
+
+size_t ActivationArena::requestedBytes() const {
+    size_t largest = 0;
+    for (const auto& [key, plan] : plans) {
+        if (!plan.planned) continue;
+        size_t bytes = 0;
+        for (const auto& r : plan.requests) bytes += r.bytes;
+        largest = std::max(largest, bytes);
+    }
+    return largest;
+}
+
+void ActivationArena::clear() {
+    plans.clear();
+    block = torch::Tensor();
+    live.clear();
+    current = nullptr;
+}
+
+} // namespace layers
+} // namespace med
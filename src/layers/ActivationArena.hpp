@@ -0,0 +1,67 @@
+#pragma once
+
+#include <torch/torch.h>
+#include <map>
+#include <vector>
+
+namespace med {
+namespace layers {
+
+// Preallocated activation buffers for repeated inference. A pass is bracketed by
+// begin()/end(); in between, a model takes its intermediates from acquire() and hands
+// them back with release(). The first pass at a new input shape allocates normally and
+// records every request and its lifetime; end() then plans offsets at which requests
+// with disjoint lifetimes share memory (greedy, largest first). Later passes at the same
+// shape receive the same views and allocate nothing. All plans share one block, grown to
+// the largest plan, since only one pass runs at a time. The request sequence of a pass
+// must depend on the input shape only. Not thread-safe.
+class ActivationArena {
+public:
+    // Start a pass for `input` (shape, dtype and device select the plan)
+    void begin(const torch::Tensor& input);
+
+    // Next buffer of this pass, uninitialized
+    torch::Tensor acquire(at::IntArrayRef sizes, const torch::TensorOptions& options,
+                          torch::MemoryFormat format = torch::MemoryFormat::Contiguous);
+
+    // The buffer is no longer read in this pass; its memory may be handed out again
+    void release(const torch::Tensor& buffer);
+
+    // Finish the pass; plans the block after a recording pass
+    void end();
+
+    // Bytes of the shared block, and what the requests of the largest plan would take
+    // without sharing (0 before the first end())
+    size_t plannedBytes() const;
+    size_t requestedBytes() const;
+
+    // Drop every plan and the block
+    void clear();
+
+private:
+    struct Request {
+        std::vector<int64_t> sizes, strides;
+        torch::TensorOptions options;
+        size_t bytes = 0;
+        size_t offset = 0; // in the block, once planned
+        int first = 0, last = -1; // event indices of acquire() and release() (-1: end of pass)
+    };
+    struct Plan {
+        std::vector<Request> requests;
+        size_t bytes = 0;     // extent of the planned offsets
+        bool planned = false; // false while recording
+    };
+
+    // Grow (or move) the shared block so that `plan` fits
+    void reserve(const Plan& plan);
+
+    std::map<std::vector<int64_t>, Plan> plans;
+    torch::Tensor block; // shared by every plan (bytes on the device of the last plan)
+    Plan* current = nullptr;
+    size_t next = 0; // index of the next request in this pass
+    int event = 0;
+    std::vector<torch::Tensor> live; // recording pass: buffers handed out, by request
+};
+
+} // namespace layers
+} // namespace med
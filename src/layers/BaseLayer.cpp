@@ -1,4 +1,7 @@
 #include "BaseLayer.hpp"
+#include "common/Exception.hpp"
+#include <ATen/core/dispatch/Dispatcher.h>
+#include <algorithm>
 
 namespace med {
 namespace layers {
@@ -6,5 +9,157 @@ namespace layers {
 BaseLayer::BaseLayer(const std::string& name) 
 : name(name) {}
 
+namespace {
+
+// Affine uint8 parameters mapping [lo, hi] onto 0..qmax (always including 0, which must be exact)
+std::pair<double, int64_t> affineParams(double lo, double hi, int64_t qmax) {
+    lo = std::min(lo, 0.0);
+    hi = std::max(hi, 0.0);
+    double scale = std::max((hi - lo) / static_cast<double>(qmax), 1e-8);
+    int64_t zeroPoint = std::clamp<int64_t>(std::llround(-lo / scale), 0, qmax);
+    return {scale, zeroPoint};
+}
+
+// fbgemm on x86, oneDNN elsewhere (whichever this libtorch was built with)
+void selectQuantizedEngine() {
+    static bool selected = [] {
+        auto engines = at::globalContext().supportedQEngines();
+        for (auto engine : {at::QEngine::FBGEMM, at::QEngine::ONEDNN, at::QEngine::QNNPACK}) {
+            if (std::find(engines.begin(), engines.end(), engine) != engines.end()) {
+                at::globalContext().setQEngine(engine);
+                return true;
+            }
+        }
+        return false;
+    }();
+    if (!selected) {
+        throw error::ModelException("this libtorch build has no quantized CPU engine");
+    }
+}
+
+} // namespace
+
+void BaseLayer::setCalibration(bool on) {
+    calibrating = on;
+    if (!on) return;
+    for (const auto& child : named_children()) {
+        if (auto conv = std::dynamic_pointer_cast<torch::nn::Conv2dImpl>(child.value())) {
+            Int8Conv& q = int8[conv.get()];
+            q.inMin = q.inMax = q.outMin = q.outMax = torch::Tensor();
+        }
+    }
+}
+
+void BaseLayer::quantize(bool calibrated) {
+    calibrating = false;
+    if (quantized) return;
+    torch::NoGradGuard noGrad;
+    // fbgemm multiplies uint8 activations by int8 weights in pairs summed to 16 bits, which
+    // can saturate with full-range activations: like PyTorch's fbgemm qconfig, use 0..127
+    selectQuantizedEngine();
+    const int64_t qmax = at::globalContext().qEngine() == at::QEngine::FBGEMM ? 127 : 255;
+    for (const auto& child : named_children()) {
+        auto conv = std::dynamic_pointer_cast<torch::nn::Conv2dImpl>(child.value());
+        if (!conv) continue;
+        Int8Conv& q = int8[conv.get()];
+        // Convs that never ran during calibration (or not through convForward) stay float;
+        // their buffers are empty, as are the placeholders filled by loadModel()
+        if (calibrated && q.inMin.defined()) {
+            // Symmetric per-output-channel weights
+            auto w = conv->weight.detach().to(torch::kCPU, torch::kFloat);
+            q.wscale = (w.abs().amax({1, 2, 3}) / 127.0).clamp_min(1e-8);
+            q.qweight = torch::round(w / q.wscale.view({-1, 1, 1, 1})).clamp(-127, 127).to(torch::kChar);
+            // One read-back per conv for the whole calibration run
+            auto range = torch::stack({q.inMin, q.inMax, q.outMin, q.outMax}).to(torch::kCPU, torch::kDouble);
+            const double* r = range.data_ptr<double>();
+            auto [inScale, inZero] = affineParams(r[0], r[1], qmax);
+            auto [outScale, outZero] = affineParams(r[2], r[3], qmax);
+            q.qparams = torch::tensor({inScale, double(inZero), outScale, double(outZero)}, torch::kDouble);
+        } else {
+            q.qweight = torch::empty({0}, torch::kChar);
+            q.wscale = torch::empty({0});
+            q.qparams = torch::empty({0}, torch::kDouble);
+        }
+        q.packed = c10::IValue();
+        q.qweight = register_buffer(child.key() + "_qweight", q.qweight);
+        q.wscale = register_buffer(child.key() + "_wscale", q.wscale);
+        q.qparams = register_buffer(child.key() + "_qparams", q.qparams);
+    }
+    quantized = true;
+}
+
+torch::Tensor BaseLayer::convForward(const torch::nn::Conv2d& conv, const torch::Tensor& x) {
+    if (!calibrating && !quantized) {
+        return conv->forward(x);
+    }
+    auto it = int8.find(conv.get());
+    if (it == int8.end() || (quantized && it->second.qparams.numel() != 4)) {
+        return conv->forward(x);
+    }
+    Int8Conv& q = it->second;
+    if (calibrating) {
+        auto y = conv->forward(x);
+        // Running ranges stay on the device: no synchronization per batch
+        auto [inMin, inMax] = torch::aminmax(x.detach());
+        auto [outMin, outMax] = torch::aminmax(y.detach());
+        q.inMin = q.inMin.defined() ? torch::minimum(q.inMin, inMin) : inMin;
+        q.inMax = q.inMax.defined() ? torch::maximum(q.inMax, inMax) : inMax;
+        q.outMin = q.outMin.defined() ? torch::minimum(q.outMin, outMin) : outMin;
+        q.outMax = q.outMax.defined() ? torch::maximum(q.outMax, outMax) : outMax;
+        return y;
+    }
+
+    if (q.packed.isNone()) {
+        // Prepacking reorders the weights for the engine's kernels; done once per conv
+        selectQuantizedEngine();
+        const auto& o = conv->options;
+        const auto* padding = std::get_if<torch::ExpandingArray<2>>(&o.padding());
+        if (!padding) {
+            throw error::ModelException("int8 convs need explicit padding");
+        }
+        auto weight = torch::_make_per_channel_quantized_tensor(
+            q.qweight, q.wscale.to(torch::kDouble), torch::zeros_like(q.wscale, torch::kLong), 0);
+        static const auto prepack = c10::Dispatcher::singleton().findSchemaOrThrow("quantized::conv2d_prepack", "");
+        std::vector<c10::IValue> stack{weight,
+                                       conv->bias.defined() ? c10::IValue(conv->bias.detach().cpu()) : c10::IValue(),
+                                       o.stride().vec(), padding->vec(), o.dilation().vec(), o.groups()};
+        prepack.callBoxed(&stack);
+        q.packed = stack[0];
+    }
+    const double* p = q.qparams.data_ptr<double>();
+    auto qx = torch::quantize_per_tensor(x.to(torch::kFloat).contiguous(torch::MemoryFormat::ChannelsLast),
+                                         p[0], static_cast<int64_t>(p[1]), torch::kQUInt8);
+    static const auto conv2d = c10::Dispatcher::singleton().findSchemaOrThrow("quantized::conv2d", "new");
+    std::vector<c10::IValue> stack{qx, q.packed, p[2], static_cast<int64_t>(p[3])};
+    conv2d.callBoxed(&stack);
+    return stack[0].toTensor().dequantize();
+}
+
+torch::nn::Conv2d foldConvBN(const torch::nn::Conv2d& conv, const torch::nn::BatchNorm2d& bn) {
+    torch::NoGradGuard noGrad;
+    // y = gamma * (conv(x) + b - mean) / sqrt(var + eps) + beta, per output channel
+    auto scale = bn->weight / torch::sqrt(bn->running_var + bn->options.eps());
+    auto bias = conv->bias.defined() ? conv->bias : torch::zeros_like(bn->running_mean);
+
+    const auto& o = conv->options;
+    torch::nn::Conv2d folded(torch::nn::Conv2dOptions(o.in_channels(), o.out_channels(), o.kernel_size())
+                             .stride(o.stride()).padding(o.padding()).dilation(o.dilation())
+                             .groups(o.groups()).padding_mode(o.padding_mode()).bias(true));
+    folded->to(conv->weight.device(), conv->weight.scalar_type());
+    auto format = conv->weight.suggest_memory_format();
+    folded->weight.set_data((conv->weight * scale.reshape({-1, 1, 1, 1})).contiguous(format));
+    folded->bias.set_data((bias - bn->running_mean) * scale + bn->bias);
+    folded->eval();
+    return folded;
+}
+
+torch::nn::Sequential fuseDownsample(const torch::nn::Sequential& downsample) {
+    if (downsample->size() != 2) return downsample;
+    auto conv = std::dynamic_pointer_cast<torch::nn::Conv2dImpl>(downsample->ptr(0));
+    auto bn = std::dynamic_pointer_cast<torch::nn::BatchNorm2dImpl>(downsample->ptr(1));
+    if (!conv || !bn) return downsample;
+    return torch::nn::Sequential(foldConvBN(torch::nn::Conv2d(conv), torch::nn::BatchNorm2d(bn)));
+}
+
 }
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <torch/torch.h>
+#include <cmath>
+#include <unordered_map>
 
 namespace med {
 namespace layers {
@@ -17,15 +19,55 @@ public:
     // Forward pass (pure virtual function)
     virtual torch::Tensor forward(torch::Tensor x) = 0;
 
+    // Inference only: fold eval-mode BatchNorm statistics into the adjacent convolutions
+    // where that is exact. Idempotent; the layer must not be trained or saved afterwards.
+    virtual void fuseForInference() {}
+
+    // Post-training int8 (CPU only). While calibrating, the layer records the input and
+    // output range of every conv it runs through convForward(). quantize() then replaces
+    // those convs with quantized fbgemm/oneDNN kernels: per-channel int8 weights, and
+    // activations quantized to uint8 with the calibrated ranges (0..127 on fbgemm, whose
+    // 16-bit intermediate sums could otherwise saturate). The int8 weights and
+    // ranges are registered as buffers, so saveModel() stores them. quantize(false)
+    // registers empty buffers of the same names for loadModel() to fill.
+    void setCalibration(bool on);
+    void quantize(bool calibrated = true);
+
     // Overloaded operator<< for printing layer info
     friend std::ostream& operator<<(std::ostream& os, const BaseLayer& layer) {
         os << "Layer: " << layer.name;
         return os;
     }
 
+protected:
+    // conv->forward(x), or its int8 replacement once quantize() has run
+    torch::Tensor convForward(const torch::nn::Conv2d& conv, const torch::Tensor& x);
+
+    bool fused = false; // fuseForInference() has run
+
 private:
+    // Int8 state of one conv (buffers named <conv>_qweight, <conv>_wscale, <conv>_qparams)
+    struct Int8Conv {
+        torch::Tensor qweight; // int8 [Cout, Cin/groups, kH, kW]
+        torch::Tensor wscale;  // per-output-channel weight scale [Cout]
+        torch::Tensor qparams; // input scale, input zero point, output scale, output zero point (empty: float)
+        c10::IValue packed;    // prepacked weights, built on first use
+        // Calibrated input/output ranges: 0-dim tensors on the activations' device, read
+        // back once by quantize() (undefined until the conv runs while calibrating)
+        torch::Tensor inMin, inMax, outMin, outMax;
+    };
+
     std::string name; // Name of the layer
+    std::unordered_map<const torch::nn::Conv2dImpl*, Int8Conv> int8;
+    bool calibrating = false;
+    bool quantized = false;
 };
 
+// A conv with bias computing bn(conv(x)) with bn's running statistics (eval mode)
+torch::nn::Conv2d foldConvBN(const torch::nn::Conv2d& conv, const torch::nn::BatchNorm2d& bn);
+
+// A ResNet shortcut Sequential(conv, bn) as Sequential(folded conv); others are returned as is
+torch::nn::Sequential fuseDownsample(const torch::nn::Sequential& downsample);
+
 } // namespace layers
 } // namespace med
@@ -16,8 +16,13 @@ BasicBlock::BasicBlock(int inPlanes, int planes, int stride, torch::nn::Sequenti
 
 torch::Tensor BasicBlock::forward(torch::Tensor x) {
     auto identity = x.clone();
-    x = torch::relu(bn1->forward(conv1->forward(x)));
-    x = torch::relu(bn2->forward(conv2->forward(x)));
+    // BN layers are null once folded into the convs; ReLU reuses the conv/BN output buffer
+    x = convForward(conv1, x);
+    if (bn1) x = bn1->forward(x);
+    x = torch::relu_(x);
+    x = convForward(conv2, x);
+    if (bn2) x = bn2->forward(x);
+    x = torch::relu_(x);
     if (!downsample->is_empty()) {
         identity = downsample->forward(identity);
     }
@@ -25,5 +30,17 @@ torch::Tensor BasicBlock::forward(torch::Tensor x) {
     return torch::relu(x);
 }
 
+void BasicBlock::fuseForInference() {
+    if (fused) return;
+    conv1 = replace_module("conv1", foldConvBN(conv1, bn1));
+    conv2 = replace_module("conv2", foldConvBN(conv2, bn2));
+    bn1 = nullptr;
+    bn2 = nullptr;
+    if (!downsample->is_empty()) {
+        downsample = replace_module("downsample", fuseDownsample(downsample));
+    }
+    fused = true;
+}
+
 } // namespace layers
 } // namespace med
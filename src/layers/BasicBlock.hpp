@@ -16,6 +16,9 @@ public:
 
     // Forward pass
     torch::Tensor forward(torch::Tensor x) override;
+
+    // Fold bn1/bn2 (and the downsample BN) into the preceding convs
+    void fuseForInference() override;
     
 private:
     // Layers
@@ -14,10 +14,18 @@ med::layers::DenseLayerImpl::DenseLayerImpl(int inChannels, int growthRate)
 
 // Forward pass
 torch::Tensor med::layers::DenseLayerImpl::forward(torch::Tensor x) {
-    auto out = conv1->forward(torch::relu(bn1->forward(x)));
-    out = conv2->forward(torch::relu(bn2->forward(out)));
+    auto out = convForward(conv1, torch::relu(bn1->forward(x)));
+    if (bn2) out = bn2->forward(out); // null once folded into conv1
+    out = convForward(conv2, torch::relu_(out));
     return torch::cat({x, out}, 1);
 }
 
+void med::layers::DenseLayerImpl::fuseForInference() {
+    if (fused) return;
+    conv1 = replace_module("conv1", foldConvBN(conv1, bn2));
+    bn2 = nullptr;
+    fused = true;
+}
+
 } // namespace layers
 } // namespace med
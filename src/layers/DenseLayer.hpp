@@ -15,6 +15,9 @@ public:
     // Forward pass
     torch::Tensor forward(torch::Tensor x) override;
 
+    // Fold bn2 into conv1 (bn1 normalizes the block input before its ReLU and stays)
+    void fuseForInference() override;
+
 private:
     // Layers
     torch::nn::BatchNorm2d bn1{nullptr}, bn2{nullptr};
@@ -3,17 +3,34 @@
 namespace med {
 namespace layers {
 
-DoubleConvImpl::DoubleConvImpl(int inChannels, int outChannels) 
+DoubleConvImpl::DoubleConvImpl(int inChannels, int outChannels, bool separable) 
 : BaseLayer("Double convolution: two 3x3 conv layers with ReLU (Used in UNet)") {
-    conv1 = register_module("conv1", torch::nn::Conv2d(torch::nn::Conv2dOptions(inChannels, outChannels, 3).padding(1)));
-    conv2 = register_module("conv2", torch::nn::Conv2d(torch::nn::Conv2dOptions(outChannels, outChannels, 3).padding(1)));
+    if (!separable) {
+        conv1 = register_module("conv1", torch::nn::Conv2d(torch::nn::Conv2dOptions(inChannels, outChannels, 3).padding(1)));
+        conv2 = register_module("conv2", torch::nn::Conv2d(torch::nn::Conv2dOptions(outChannels, outChannels, 3).padding(1)));
+        return;
+    }
+    // Depthwise 3x3 (one filter per channel) followed by a pointwise 1x1 mixing channels
+    dw1 = register_module("dw1", torch::nn::Conv2d(torch::nn::Conv2dOptions(inChannels, inChannels, 3).padding(1).groups(inChannels).bias(false)));
+    conv1 = register_module("conv1", torch::nn::Conv2d(torch::nn::Conv2dOptions(inChannels, outChannels, 1)));
+    dw2 = register_module("dw2", torch::nn::Conv2d(torch::nn::Conv2dOptions(outChannels, outChannels, 3).padding(1).groups(outChannels).bias(false)));
+    conv2 = register_module("conv2", torch::nn::Conv2d(torch::nn::Conv2dOptions(outChannels, outChannels, 1)));
 }
 
 torch::Tensor DoubleConvImpl::forward(torch::Tensor x) {
-    x = torch::relu(conv1->forward(x));
-    x = torch::relu(conv2->forward(x));
+    if (dw1) x = convForward(dw1, x);
+    x = torch::relu(convForward(conv1, x));
+    if (dw2) x = convForward(dw2, x);
+    x = torch::relu(convForward(conv2, x));
     return x;
 }
 
+torch::Tensor DoubleConvImpl::forwardInto(torch::Tensor x, torch::Tensor out) {
+    if (dw1) x = convForward(dw1, x);
+    x = torch::relu_(convForward(conv1, x));
+    if (dw2) x = convForward(dw2, x);
+    return torch::clamp_min_out(out, convForward(conv2, x), 0);
+}
+
 } // namespace layers
 } // namespace med
@@ -6,18 +6,23 @@
 namespace med {
 namespace layers {
 
-// Double convolution: two 3x3 conv layers with ReLU
+// Double convolution: two 3x3 conv layers with ReLU. The separable variant factors each
+// into a depthwise 3x3 and a pointwise 1x1 conv (about 8-9x fewer multiply-adds).
 class DoubleConvImpl : public BaseLayer {
 public:
     // Constructor
-    DoubleConvImpl(int inChannels, int outChannels);
+    DoubleConvImpl(int inChannels, int outChannels, bool separable = false);
 
     // Forward pass
     torch::Tensor forward(torch::Tensor x) override;
 
+    // Forward pass whose final ReLU writes into `out` (e.g. a slice of a concat buffer)
+    torch::Tensor forwardInto(torch::Tensor x, torch::Tensor out);
+
 private:
     // Layers
     torch::nn::Conv2d conv1{nullptr}, conv2{nullptr};
+    torch::nn::Conv2d dw1{nullptr}, dw2{nullptr}; // depthwise 3x3 (separable only)
 };
 TORCH_MODULE(DoubleConv);
 
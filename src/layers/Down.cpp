@@ -3,10 +3,10 @@
 namespace med {
 namespace layers {
 
-med::layers::DownImpl::DownImpl(int inChannels, int outChannels) 
+med::layers::DownImpl::DownImpl(int inChannels, int outChannels, bool separable) 
 : BaseLayer("Down-sampling block: MaxPool2d then DoubleConv (Used in UNet)") {
     pool = register_module("pool", torch::nn::MaxPool2d(2));
-    conv = register_module("conv", DoubleConv(inChannels, outChannels));
+    conv = register_module("conv", DoubleConv(inChannels, outChannels, separable));
 }
 
 torch::Tensor med::layers::DownImpl::forward(torch::Tensor x) {
@@ -14,5 +14,18 @@ torch::Tensor med::layers::DownImpl::forward(torch::Tensor x) {
     return conv->forward(x);
 }
 
+torch::Tensor med::layers::DownImpl::forwardInto(torch::Tensor x, torch::Tensor out, ActivationArena& arena) {
+    // max_pool2d computes the argmax indices either way; the out variant lets both live in the arena
+    std::vector<int64_t> sizes{x.size(0), x.size(1), x.size(2) / 2, x.size(3) / 2};
+    auto format = x.suggest_memory_format();
+    auto pooled = arena.acquire(sizes, x.options(), format);
+    auto indices = arena.acquire(sizes, x.options().dtype(torch::kLong), format);
+    torch::max_pool2d_with_indices_out(pooled, indices, x, {2, 2}, {2, 2}, {0, 0}, {1, 1}, false);
+    arena.release(indices);
+    conv->forwardInto(pooled, out);
+    arena.release(pooled);
+    return out;
+}
+
 } // namespace layers
 } // namespace med
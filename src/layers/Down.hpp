@@ -1,6 +1,7 @@
 #pragma once
 
 #include "BaseLayer.hpp"
+#include "ActivationArena.hpp"
 #include "DoubleConv.hpp"
 #include <torch/torch.h>
 
@@ -11,10 +12,13 @@ namespace layers {
 class DownImpl : public BaseLayer {
 public:
     // Constructor
-    DownImpl(int inChannels, int outChannels);
+    DownImpl(int inChannels, int outChannels, bool separable = false);
 
     // Forward pass
     torch::Tensor forward(torch::Tensor x) override;
+
+    // Forward pass into `out`, the pooled map and its indices taken from `arena`
+    torch::Tensor forwardInto(torch::Tensor x, torch::Tensor out, ActivationArena& arena);
     
 private:
     // Layers
@@ -9,6 +9,7 @@ OutConvImpl::OutConvImpl(int inChannels, int outChannels)
 }
 
 torch::Tensor OutConvImpl::forward(torch::Tensor x) {
+    // Not through convForward: the logits stay float under int8 quantization
     return conv->forward(x);
 }
 
@@ -11,9 +11,17 @@ TransitionImpl::TransitionImpl(int inChannels, int outChannels)
 }
 
 torch::Tensor TransitionImpl::forward(torch::Tensor x) {
-    x = conv->forward(torch::relu(bn->forward(x)));
+    x = torch::relu(bn->forward(x));
+    if (fused) {
+        return convForward(conv, pool->forward(x));
+    }
+    x = convForward(conv, x);
     return pool->forward(x);
 }
 
+void TransitionImpl::fuseForInference() {
+    fused = true;
+}
+
 } // namespace layers
 } // namespace med
@@ -14,6 +14,10 @@ public:
 
     // Forward pass
     torch::Tensor forward(torch::Tensor x) override;
+
+    // Pool before the 1x1 conv from now on (both are linear and per-pixel, so they
+    // commute); the conv then runs on a quarter of the pixels
+    void fuseForInference() override;
     
 private:
     // Layers
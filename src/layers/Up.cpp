@@ -3,14 +3,27 @@
 namespace med {
 namespace layers {
 
-med::layers::UpImpl::UpImpl(int inChannels, int outChannels) 
+med::layers::UpImpl::UpImpl(int inChannels, int outChannels, bool bilinear, bool separable) 
 : BaseLayer("Up-sampling block: ConvTranspose2d then DoubleConv with skip connection (Used in UNet)") {
-    up = register_module("up", torch::nn::ConvTranspose2d(torch::nn::ConvTranspose2dOptions(inChannels, inChannels / 2, 2).stride(2)));
-    conv = register_module("conv", DoubleConv(inChannels, outChannels));
+    if (bilinear) {
+        reduce = register_module("reduce", torch::nn::Conv2d(torch::nn::Conv2dOptions(inChannels, inChannels / 2, 1)));
+    } else {
+        up = register_module("up", torch::nn::ConvTranspose2d(torch::nn::ConvTranspose2dOptions(inChannels, inChannels / 2, 2).stride(2)));
+    }
+    conv = register_module("conv", DoubleConv(inChannels, outChannels, separable));
 }
 
 torch::Tensor med::layers::UpImpl::forward_(torch::Tensor x1, torch::Tensor x2) {
-    x1 = up->forward(x1);
+    if (reduce) {
+        // A 1x1 conv commutes with bilinear interpolation, so reduce before upsampling
+        x1 = torch::nn::functional::interpolate(convForward(reduce, x1),
+            torch::nn::functional::InterpolateFuncOptions()
+                .scale_factor(std::vector<double>{2.0, 2.0})
+                .mode(torch::kBilinear)
+                .align_corners(false));
+    } else {
+        x1 = up->forward(x1);
+    }
     auto diffY = x2.size(2) - x1.size(2);
     auto diffX = x2.size(3) - x1.size(3);
     x1 = torch::constant_pad_nd(x1, {diffX / 2, diffX - diffX / 2, diffY /2 , diffY - diffY / 2});
@@ -18,5 +31,31 @@ torch::Tensor med::layers::UpImpl::forward_(torch::Tensor x1, torch::Tensor x2)
     return conv->forward(x);
 }
 
+torch::Tensor med::layers::UpImpl::forwardInto(torch::Tensor x1, torch::Tensor cat) {
+    const int64_t half = cat.size(1) / 2;
+    auto dst = cat.narrow(1, half, half);
+    if (reduce) {
+        x1 = convForward(reduce, x1);
+        if (x1.size(2) * 2 == cat.size(2) && x1.size(3) * 2 == cat.size(3)) {
+            // Interpolate straight into the destination slice
+            torch::upsample_bilinear2d_out(dst, x1, {cat.size(2), cat.size(3)}, false, 2.0, 2.0);
+            return conv->forward(cat);
+        }
+        x1 = torch::nn::functional::interpolate(x1,
+            torch::nn::functional::InterpolateFuncOptions()
+                .scale_factor(std::vector<double>{2.0, 2.0})
+                .mode(torch::kBilinear)
+                .align_corners(false));
+    } else {
+        x1 = up->forward(x1);
+    }
+    // Odd sizes: zero border around the upsampled map, as constant_pad_nd in forward_()
+    auto diffY = cat.size(2) - x1.size(2);
+    auto diffX = cat.size(3) - x1.size(3);
+    if (diffY != 0 || diffX != 0) dst.zero_();
+    dst.narrow(2, diffY / 2, x1.size(2)).narrow(3, diffX / 2, x1.size(3)).copy_(x1);
+    return conv->forward(cat);
+}
+
 } // namespace layers
 } // namespace med
@@ -7,14 +7,19 @@
 namespace med {
 namespace layers {
 
-// Up-sampling block: ConvTranspose2d then DoubleConv with skip connection
+// Up-sampling block: ConvTranspose2d then DoubleConv with skip connection.
+// The bilinear variant halves the channels with a 1x1 conv at the low resolution and
+// upsamples bilinearly (4x fewer multiply-adds than the 2x2 transposed conv).
 class UpImpl : public BaseLayer {
 public:
     // Constructor
-    UpImpl(int inChannels, int outChannels);
+    UpImpl(int inChannels, int outChannels, bool bilinear = false, bool separable = false);
 
     // Forward pass
     torch::Tensor forward_(torch::Tensor x1, torch::Tensor x2);
+    // Forward pass on a preassembled concat buffer [B, in, H, W] whose first half already
+    // holds the skip connection; the upsampled x1 is written into the second half
+    torch::Tensor forwardInto(torch::Tensor x1, torch::Tensor cat);
     torch::Tensor forward(torch::Tensor x) override {
         throw std::runtime_error("UpImpl::forward() should not be called directly, use forward_(x1, x2) instead.");
     }
@@ -22,6 +27,7 @@ public:
 private:
     // Layers
     torch::nn::ConvTranspose2d up{nullptr};
+    torch::nn::Conv2d reduce{nullptr}; // 1x1 channel reduction (bilinear only)
     DoubleConv conv{nullptr};
 };
 TORCH_MODULE(Up);
@@ -1,4 +1,8 @@
 #include "BaseModel.hpp"
+#include "common/Exception.hpp"
+#include <filesystem>
+#include "MappedWeights.hpp"
+#include "layers/BaseLayer.hpp"
 
 namespace med {
 namespace models {
@@ -19,7 +23,24 @@ BaseModel& med::models::BaseModel::operator=(const BaseModel& other) {
 
 BaseModel::~BaseModel() {}
 
+torch::Tensor BaseModel::embed(const torch::Tensor& /*input*/) {
+    throw error::ModelException(name + " has no separate backbone/head to embed with");
+}
+
+torch::nn::Linear BaseModel::head() {
+    return torch::nn::Linear{nullptr};
+}
+
+void BaseModel::resetHead(int /*numClasses*/) {
+    throw error::ModelException(name + " has no classification head to reset");
+}
+
 void BaseModel::saveModel(const std::string& filename) const {
+    if (std::filesystem::path(filename).extension() == ".medw") {
+        MappedWeights::write(*this, filename);
+        std::cout << "[" << name << "] Saved mapped weights to " << filename << "\n";
+        return;
+    }
     torch::serialize::OutputArchive archive;
     this->save(archive);
     archive.save_to(filename);
@@ -27,11 +48,64 @@ void BaseModel::saveModel(const std::string& filename) const {
 }
 
 void BaseModel::loadModel(const std::string& filename) {
+    if (MappedWeights::isMappedFile(filename)) {
+        size_t n = MappedWeights::bind(*this, filename, device);
+        foldInputChannels();
+        std::cout << "[" << name << "] Mapped " << n << " tensors from " << filename << "\n";
+        return;
+    }
     torch::serialize::InputArchive archive;
     archive.load_from(filename);
     this->load(archive);
+    foldInputChannels();
     std::cout << "[" << name << "] Loaded model from " << filename << "\n";
 }
 
+void BaseModel::fuseForInference() {
+    eval();
+    // DenseBlock lists its layers twice; fuseForInference() is idempotent
+    for (const auto& module : this->modules(/*include_self=*/false)) {
+        if (auto layer = std::dynamic_pointer_cast<layers::BaseLayer>(module)) {
+            layer->fuseForInference();
+        }
+    }
+}
+
+void BaseModel::setCalibration(bool on) {
+    for (const auto& module : this->modules(/*include_self=*/false)) {
+        if (auto layer = std::dynamic_pointer_cast<layers::BaseLayer>(module)) {
+            layer->setCalibration(on);
+        }
+    }
+}
+
+void BaseModel::quantize(bool calibrated) {
+    if (device.type() != torch::kCPU) {
+        throw error::ModelException("int8 quantization needs the model on the CPU");
+    }
+    eval();
+    for (const auto& module : this->modules(/*include_self=*/false)) {
+        if (auto layer = std::dynamic_pointer_cast<layers::BaseLayer>(module)) {
+            layer->quantize(calibrated);
+        }
+    }
+}
+
+void BaseModel::foldInputChannels() {
+    // Loading re-binds each weight to the stored tensor, so a 3-channel checkpoint leaves
+    // [C,3,k,k] filters in a 1-channel conv. Summing over the input axis gives the exact
+    // response the 3-channel model had to a replicated grayscale image.
+    torch::NoGradGuard noGrad;
+    for (const auto& module : this->modules(/*include_self=*/false)) {
+        auto* conv = module->as<torch::nn::Conv2dImpl>();
+        if (!conv) continue;
+        int64_t expected = conv->options.in_channels() / conv->options.groups();
+        if (expected == 1 && conv->weight.size(1) == 3) {
+            conv->weight.set_data(conv->weight.sum(1, /*keepdim=*/true));
+            std::cout << "[" << name << "] Folded 3-channel stem weights into 1 input channel\n";
+        }
+    }
+}
+
 } // namespace models
 } // namespace med
@@ -25,10 +25,38 @@ public:
     // Predict output given an input tensor
     virtual torch::Tensor predict(const torch::Tensor& input) = 0;
 
-    // Save model weights to file
+    // Pooled backbone features that feed the classification head ([B,D]).
+    // Only classifiers have one; the default throws ModelException.
+    virtual torch::Tensor embed(const torch::Tensor& input);
+
+    // Final Linear layer mapping embed() to logits (empty holder if the model has none)
+    virtual torch::nn::Linear head();
+
+    // Replace the head by a freshly initialized Linear with `numClasses` outputs, on the
+    // head's device. The default throws ModelException.
+    virtual void resetHead(int numClasses);
+
+    // Inference only: fold BatchNorm into the adjacent convolutions of every layer (see
+    // BaseLayer::fuseForInference). Changes the parameter set, so save weights before this.
+    virtual void fuseForInference();
+
+    // Post-training int8 of every layer's convs (see BaseLayer::quantize); stems and
+    // heads stay float. Calibrate by running predict() between setCalibration(true) and
+    // quantize(); quantize(false) prepares a model for loading saved int8 weights.
+    void setCalibration(bool on);
+    void quantize(bool calibrated = true);
+
+    // Inference only: take intermediates from a preallocated, lifetime-planned arena
+    // (see layers::ActivationArena) instead of allocating them on every call. Returns
+    // false if the model has no such mode.
+    virtual bool setActivationArena(bool /*on*/) { return false; }
+
+    // Save model weights to file; a ".medw" name writes the memory-mapped format
+    // (see MappedWeights), anything else a torch archive
     virtual void saveModel(const std::string& filename) const;
 
-    // Load model weights from file
+    // Load model weights from file: MEDW files are mapped and bound without copying,
+    // torch archives are parsed
     virtual void loadModel(const std::string& filename);
 
     // Overloaded operator<< for printing model info
@@ -38,6 +66,9 @@ public:
     }
 
 protected:
+    // After loading: sum the RGB filters of 3-channel checkpoints for 1-channel convs
+    void foldInputChannels();
+
     std::string name;
     torch::Device device;
 };
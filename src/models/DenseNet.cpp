@@ -8,7 +8,8 @@ DenseNetImpl::DenseNetImpl(
     int growthRate_,
     int numInitFeatures,
     int numClasses,
-    torch::Device device
+    torch::Device device,
+    int inChannels
 ) : BaseModel("DenseNet", device),
     blockConfig(blockConfig_),
     growthRate(growthRate_),
@@ -17,7 +18,7 @@ DenseNetImpl::DenseNetImpl(
     avgPool(torch::nn::AdaptiveAvgPool2dOptions({1,1}))
 {
     // Initial conv + BN
-    initConv = register_module("init_conv", torch::nn::Conv2d(torch::nn::Conv2dOptions(3, numInitFeatures, 7).stride(2).padding(3).bias(false)));
+    initConv = register_module("init_conv", torch::nn::Conv2d(torch::nn::Conv2dOptions(inChannels, numInitFeatures, 7).stride(2).padding(3).bias(false)));
     initBN = register_module("init_bn", torch::nn::BatchNorm2d(numInitFeatures));
 
     // Build features
@@ -45,15 +46,37 @@ DenseNetImpl::DenseNetImpl(
 }
 
 torch::Tensor DenseNetImpl::predict(const torch::Tensor& input) {
+    return classifier->forward(embed(input));
+}
+
+torch::Tensor DenseNetImpl::embed(const torch::Tensor& input) {
     // Initial layers
-    auto out = initPool->forward(initReLU->forward(initBN->forward(initConv->forward(input))));
+    auto out = initConv->forward(input);
+    if (initBN) out = initBN->forward(out); // null once folded into init_conv
+    out = initPool->forward(initReLU->forward(out));
     // Forward through the sequential of blocks/transitions
     out = features->forward(out);
-    // Final batchnorm, pooling, flatten + linear
+    // Final batchnorm, pooling, flatten
     out = torch::relu(finalBN->forward(out));
     out = avgPool->forward(out);
-    out = out.view({out.size(0), -1});
-    return classifier->forward(out);
+    return torch::flatten(out, 1); // no batch size baked into traced graphs
+}
+
+torch::nn::Linear DenseNetImpl::head() {
+    return classifier;
+}
+
+void DenseNetImpl::resetHead(int numClasses) {
+    classifier = replace_module("classifier", torch::nn::Linear(classifier->options.in_features(), numClasses));
+    classifier->to(device);
+}
+
+void DenseNetImpl::fuseForInference() {
+    if (initBN) {
+        initConv = replace_module("init_conv", layers::foldConvBN(initConv, initBN));
+        initBN = nullptr;
+    }
+    BaseModel::fuseForInference();
 }
 
 } // namespace models
@@ -19,12 +19,21 @@ public:
         int growthRate,
         int numInitFeatures = 64,
         int numClasses = 1000,
-        torch::Device device = torch::kCPU
+        torch::Device device = torch::kCPU,
+        int inChannels = 3 // 1 takes grayscale input directly
     );
 
     // Forward pass
     torch::Tensor predict(const torch::Tensor& input) override;
 
+    // Pooled features before the classifier / the classifier itself
+    torch::Tensor embed(const torch::Tensor& input) override;
+    torch::nn::Linear head() override;
+    void resetHead(int numClasses) override;
+
+    // Stem plus every dense layer and transition (final_bn feeds a ReLU directly and stays)
+    void fuseForInference() override;
+
 private:
     // Layers
     // Initial convolution + pooling
@@ -0,0 +1,239 @@
+#include "MappedWeights.hpp"
+#include "common/Exception.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace med {
+namespace models {
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'E', 'D', 'W', 'G', 'T', '0', '1'};
+constexpr size_t kAlign = 64; // blob alignment: cache lines and every SIMD width
+
+struct Header {
+    char magic[8];
+    uint64_t count;      // index records
+    uint64_t indexBytes; // size of the index following the header
+    uint64_t dataOffset; // file offset of the first blob
+};
+static_assert(sizeof(Header) == 32, "MappedWeights header must stay 32 bytes");
+
+// One index record: u32 name length, name, u8 dtype, u8 ndim, i64 sizes[ndim],
+// u64 blob offset (from dataOffset), u64 blob bytes
+struct Record {
+    std::string name;
+    torch::ScalarType dtype;
+    std::vector<int64_t> sizes;
+    uint64_t offset = 0, bytes = 0;
+};
+
+size_t alignUp(size_t n) { return (n + kAlign - 1) & ~(kAlign - 1); }
+
+template <class T>
+void put(std::string& out, const T& v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+// Reads index fields with bounds checks; the file may be truncated or foreign
+struct Reader {
+    const char* p;
+    const char* end;
+    template <class T>
+    T get() {
+        if (static_cast<size_t>(end - p) < sizeof(T)) throw std::out_of_range("index");
+        T v;
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    std::string str(size_t n) {
+        if (static_cast<size_t>(end - p) < n) throw std::out_of_range("index");
+        std::string s(p, n);
+        p += n;
+        return s;
+    }
+};
+
+// Private view of the file, unmapped when the last tensor pointing into it goes away
+struct Mapping {
+    void* data = nullptr;
+    size_t bytes = 0;
+    ~Mapping() {
+        if (data) ::munmap(data, bytes);
+    }
+};
+
+// Parameters and buffers of a module by name
+std::vector<std::pair<std::string, torch::Tensor>> namedTensors(const torch::nn::Module& module) {
+    std::vector<std::pair<std::string, torch::Tensor>> out;
+    for (const auto& item : module.named_parameters()) out.emplace_back(item.key(), item.value());
+    for (const auto& item : module.named_buffers()) out.emplace_back(item.key(), item.value());
+    return out;
+}
+
+} // namespace
+
+void MappedWeights::write(const torch::nn::Module& module, const std::string& path) {
+    // Distinct tensors in registration order; DenseBlock lists each layer twice
+    std::vector<Record> records;
+    std::vector<torch::Tensor> blobs;
+    std::unordered_map<const void*, size_t> blobOf; // TensorImpl -> index into blobs
+    std::vector<uint64_t> blobOffsets;
+    uint64_t dataBytes = 0;
+    for (const auto& [name, tensor] : namedTensors(module)) {
+        if (!tensor.defined()) continue;
+        if (tensor.is_quantized()) {
+            throw error::ModelException(name + " is a quantized tensor; the MEDW format stores plain tensors only");
+        }
+        auto [it, fresh] = blobOf.emplace(tensor.unsafeGetTensorImpl(), blobs.size());
+        if (fresh) {
+            blobs.push_back(tensor.detach().to(torch::kCPU).contiguous());
+            blobOffsets.push_back(dataBytes);
+            dataBytes = alignUp(dataBytes + blobs.back().nbytes());
+        }
+        Record r;
+        r.name = name;
+        r.dtype = tensor.scalar_type();
+        r.sizes = tensor.sizes().vec();
+        r.offset = blobOffsets[it->second];
+        r.bytes = blobs[it->second].nbytes();
+        records.push_back(std::move(r));
+    }
+
+    std::string index;
+    for (const auto& r : records) {
+        put(index, static_cast<uint32_t>(r.name.size()));
+        index += r.name;
+        put(index, static_cast<uint8_t>(r.dtype));
+        put(index, static_cast<uint8_t>(r.sizes.size()));
+        for (int64_t s : r.sizes) put(index, s);
+        put(index, r.offset);
+        put(index, r.bytes);
+    }
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.count = records.size();
+    header.indexBytes = index.size();
+    header.dataOffset = alignUp(sizeof(Header) + index.size());
+
+    // Written next to the target and renamed, so a crash never leaves a torn file behind
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw error::FileIOException(tmp, false);
+        }
+        const std::vector<char> zeros(kAlign, 0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(index.data(), index.size());
+        out.write(zeros.data(), header.dataOffset - sizeof(Header) - index.size());
+        for (size_t b = 0; b < blobs.size(); ++b) {
+            size_t n = blobs[b].nbytes();
+            out.write(static_cast<const char*>(blobs[b].data_ptr()), n);
+            out.write(zeros.data(), alignUp(n) - n);
+        }
+        if (!out) {
+            throw error::FileIOException(tmp, false);
+        }
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+bool MappedWeights::isMappedFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+size_t MappedWeights::bind(torch::nn::Module& module, const std::string& path, torch::Device device) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw error::FileIOException(path, true);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        throw error::ModelException(path + " is truncated");
+    }
+    auto mapping = std::make_shared<Mapping>();
+    mapping->bytes = static_cast<size_t>(st.st_size);
+    // Writable private mapping: copy-on-write, the file itself is never modified
+    void* data = ::mmap(nullptr, mapping->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (data == MAP_FAILED) {
+        throw error::FileIOException(path, true);
+    }
+    mapping->data = data;
+    char* base = static_cast<char*>(data);
+
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.indexBytes > mapping->bytes - sizeof(Header) || header.dataOffset > mapping->bytes) {
+        throw error::ModelException(path + " is not a MEDW weight file");
+    }
+
+    std::unordered_map<std::string, Record> records;
+    try {
+        Reader in{base + sizeof(Header), base + sizeof(Header) + header.indexBytes};
+        for (uint64_t k = 0; k < header.count; ++k) {
+            Record r;
+            r.name = in.str(in.get<uint32_t>());
+            auto dtype = in.get<uint8_t>();
+            if (dtype >= static_cast<uint8_t>(torch::ScalarType::NumOptions)) throw std::out_of_range("dtype");
+            r.dtype = static_cast<torch::ScalarType>(dtype);
+            r.sizes.resize(in.get<uint8_t>());
+            for (auto& s : r.sizes) s = in.get<int64_t>();
+            r.offset = in.get<uint64_t>();
+            r.bytes = in.get<uint64_t>();
+            records.emplace(r.name, std::move(r));
+        }
+    } catch (const std::out_of_range&) {
+        throw error::ModelException(path + " has a truncated or corrupt index");
+    }
+
+    torch::NoGradGuard noGrad;
+    std::unordered_set<const void*> bound;
+    for (auto& [name, tensor] : namedTensors(module)) {
+        if (!tensor.defined()) continue;
+        auto it = records.find(name);
+        if (it == records.end()) {
+            throw error::ModelException(path + " has no tensor " + name);
+        }
+        const Record& r = it->second;
+        auto options = torch::TensorOptions().dtype(r.dtype);
+        int64_t numel = 1;
+        for (int64_t s : r.sizes) numel *= s;
+        if (static_cast<uint64_t>(numel) * c10::elementSize(r.dtype) != r.bytes ||
+            r.offset > mapping->bytes - header.dataOffset ||
+            r.bytes > mapping->bytes - header.dataOffset - r.offset) {
+            throw error::ModelException(path + ": record " + name + " is inconsistent with the file");
+        }
+        torch::Tensor blob;
+        if (r.bytes == 0) {
+            blob = torch::empty(r.sizes, options);
+        } else {
+            // The deleter holds the mapping, so it outlives every tensor bound to it
+            blob = torch::from_blob(base + header.dataOffset + r.offset, r.sizes,
+                                    [mapping](void*) {}, options);
+        }
+        // Same semantics as InputArchive: the tensor is re-bound whatever its old shape
+        tensor.set_data(device.is_cpu() ? blob : blob.to(device));
+        bound.insert(tensor.unsafeGetTensorImpl());
+    }
+    return bound.size();
+}
+
+} // namespace models
+} // namespace med
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <torch/torch.h>
+#include <string>
+
+namespace med {
+namespace models {
+
+// Flat checkpoint format for fast start-up ("*.medw"). Layout: 32-byte header (magic
+// "MEDWGT01", record count, index size, data offset), one index record per tensor
+// (name, dtype, shape, blob offset and size), then the raw tensor blobs in host byte
+// order, each 64-byte aligned. Loading maps the file and points every parameter and
+// buffer of the module straight at its blob: nothing is parsed or copied, so start-up
+// no longer grows with the model. The mapping is private copy-on-write; pages are read
+// on first touch, and training on bound weights copies only the pages it writes.
+class MappedWeights {
+public:
+    // Write all parameters and buffers of `module` to `path` (via a temporary file +
+    // rename). Tensors registered under several names are stored once.
+    static void write(const torch::nn::Module& module, const std::string& path);
+
+    // True if `path` starts with the MEDW magic
+    static bool isMappedFile(const std::string& path);
+
+    // Map `path` and bind every parameter and buffer of `module` to its blob; tensors on
+    // another device than the CPU get a copy there. The mapping lives as long as any
+    // bound tensor. Returns the number of distinct tensors bound.
+    static size_t bind(torch::nn::Module& module, const std::string& path, torch::Device device);
+};
+
+} // namespace models
+} // namespace med
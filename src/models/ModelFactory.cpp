@@ -0,0 +1,131 @@
+#include "ModelFactory.hpp"
+#include "common/Exception.hpp"
+#include "models/UNet.hpp"
+#include "models/DenseNet.hpp"
+#include "models/ResNet.hpp"
+#include <filesystem>
+#include <sstream>
+
+namespace med {
+namespace models {
+
+std::shared_ptr<BaseModel> ModelFactory::create(const common::Config& cfg, torch::Device device) {
+    // Create a polymorphic BaseModel shared_ptr
+    std::shared_ptr<BaseModel> model;
+
+    // Build the actual implementation and upcast
+    switch (cfg.modelType) {
+        case common::ModelType::UNet: {
+            UNetOptions options;
+            options.width = cfg.unetWidth;
+            options.depth = cfg.unetDepth;
+            options.separable = cfg.unetSeparable;
+            options.bilinear = cfg.unetBilinear;
+            auto unetImpl = std::make_shared<UNetImpl>(1, 1, device, options);
+            model = unetImpl;  // upcast to shared_ptr<BaseModel>
+            break;
+        }
+
+        case common::ModelType::DenseNet: {
+            std::vector<int> blockCfg {6,12,24,16};
+            int growthRate = 32;
+            int numClasses = ModelFactory::numClasses(cfg, 2);
+            auto dnetImpl = std::make_shared<DenseNetImpl>(blockCfg, growthRate, 64, numClasses, device, cfg.inChannels);
+            model = dnetImpl; // upcast
+            break;
+        }
+
+        case common::ModelType::ResNet: {
+            int numClasses = ModelFactory::numClasses(cfg, 1000);
+            // Cast common::ResNetVersion → models::ResNet::Version
+            auto versionImpl = static_cast<ResNet::Version>(cfg.resnetVersion);
+            auto resImpl = std::make_shared<ResNet>(versionImpl, numClasses, device, cfg.inChannels);
+            model = resImpl;  // upcast
+            break;
+        }
+
+        default:
+            throw error::ConfigException("ModelFactory", "Unknown model type");
+    }
+
+    model->to(device);
+    applyMemoryFormat(*model, cfg);
+    return model;
+}
+
+std::string ModelFactory::name(const common::Config& cfg) {
+    static const char* resnetNames[] = {"18", "34", "50", "101", "152"};
+    switch (cfg.modelType) {
+        case common::ModelType::UNet: {
+            std::ostringstream os;
+            os << "unet";
+            if (cfg.unetWidth != 1.0) os << "-w" << cfg.unetWidth;
+            if (cfg.unetDepth != 4) os << "-d" << cfg.unetDepth;
+            if (cfg.unetSeparable) os << "-sep";
+            if (cfg.unetBilinear) os << "-bil";
+            return os.str();
+        }
+        case common::ModelType::DenseNet:
+            return "densenet";
+        case common::ModelType::ResNet:
+            return std::string("resnet") + resnetNames[static_cast<int>(cfg.resnetVersion)];
+        default:
+            return "unknown";
+    }
+}
+
+int ModelFactory::inputSize(const common::Config& cfg) {
+    if (cfg.modelType == common::ModelType::UNet && cfg.trainCrop > 0) return cfg.trainCrop;
+    if (cfg.imageSize > 0) return cfg.imageSize;
+    return cfg.modelType == common::ModelType::UNet ? 256 : 224;
+}
+
+int ModelFactory::inputChannels(const common::Config& cfg) {
+    return cfg.modelType == common::ModelType::UNet ? 1 : cfg.inChannels;
+}
+
+int ModelFactory::numClasses(const common::Config& cfg, int fallback) {
+    int count = 0;
+    if (!cfg.clsTrainDir.empty()) {
+        std::error_code ec; // a missing directory counts as no classes
+        for (const auto& entry : std::filesystem::directory_iterator(cfg.clsTrainDir, ec)) {
+            if (entry.is_directory() && entry.path().filename() != "cache") ++count;
+        }
+    }
+    return count > 0 ? count : fallback;
+}
+
+void ModelFactory::applyMemoryFormat(BaseModel& model, const common::Config& cfg) {
+    if (!cfg.channelsLast) return;
+    torch::NoGradGuard noGrad;
+    for (auto& p : model.parameters()) {
+        if (p.dim() == 4) {
+            p.set_data(p.data().contiguous(torch::MemoryFormat::ChannelsLast));
+        }
+    }
+}
+
+double ModelFactory::foldBatchNorm(BaseModel& model, const common::Config& cfg, torch::Device device) {
+    int side = inputSize(cfg);
+    auto probe = torch::randn({2, inputChannels(cfg), side, side}, torch::TensorOptions().device(device));
+    if (cfg.channelsLast) {
+        probe = probe.contiguous(torch::MemoryFormat::ChannelsLast);
+    }
+    model.eval();
+    torch::Tensor reference, folded;
+    {
+        torch::InferenceMode guard;
+        reference = model.predict(probe);
+    }
+    model.fuseForInference();
+    // The folded convs are new parameters
+    applyMemoryFormat(model, cfg);
+    {
+        torch::InferenceMode guard;
+        folded = model.predict(probe);
+    }
+    return (folded - reference).abs().max().item<double>();
+}
+
+} // namespace models
+} // namespace med
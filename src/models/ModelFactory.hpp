@@ -0,0 +1,40 @@
+#pragma once
+
+#include "BaseModel.hpp"
+#include "common/ArgParser.hpp"
+#include <memory>
+#include <torch/torch.h>
+
+namespace med {
+namespace models {
+
+// Factory: builds the BaseModel subtype selected by cfg.modelType
+class ModelFactory {
+public:
+    // Construct the model and move it to `device`
+    static std::shared_ptr<BaseModel> create(const common::Config& cfg, torch::Device device);
+
+    // Short architecture name, including the UNet variant ("resnet50", "unet-w0.5-d3-sep-bil")
+    static std::string name(const common::Config& cfg);
+
+    // Full input side length: cfg.trainCrop (UNet), cfg.imageSize, or 256 for UNet and 224 for the classifiers
+    static int inputSize(const common::Config& cfg);
+
+    // Input channels the model expects: 1 for UNet, cfg.inChannels for the classifiers
+    static int inputChannels(const common::Config& cfg);
+
+    // Classes of cfg.clsTrainDir: one per subdirectory (except the loader's "cache"),
+    // the same list ClassificationTrainer labels with; `fallback` when there are none
+    static int numClasses(const common::Config& cfg, int fallback);
+
+    // Store 4-D weights channels-last when cfg.channelsLast is set (again after loading
+    // weights, since deserialization re-binds parameters to the stored layout)
+    static void applyMemoryFormat(BaseModel& model, const common::Config& cfg);
+
+    // Fold BatchNorm into the convolutions (BaseModel::fuseForInference) and check the
+    // result on a random batch; returns the largest absolute output difference
+    static double foldBatchNorm(BaseModel& model, const common::Config& cfg, torch::Device device);
+};
+
+} // namespace models
+} // namespace med
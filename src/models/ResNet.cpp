@@ -7,28 +7,28 @@ namespace models {
 template class ResNetImpl<med::layers::BasicBlock>;
 template class ResNetImpl<med::layers::Bottleneck>;
 
-ResNet::ResNet(Version ver, int numClasses, torch::Device device)
+ResNet::ResNet(Version ver, int numClasses, torch::Device device, int inChannels)
 : BaseModel("ResNet", device),
   version_(ver)
 {
     if (ver == R18) {
-        res18 = std::make_shared<ResNet18Impl>(std::vector<int>{2,2,2,2}, numClasses);
+        res18 = std::make_shared<ResNet18Impl>(std::vector<int>{2,2,2,2}, numClasses, inChannels);
         register_module("resnet", res18);
     }
     else if (ver == R34) {
-        res34 = std::make_shared<ResNet34Impl>(std::vector<int>{3,4,6,3}, numClasses);
+        res34 = std::make_shared<ResNet34Impl>(std::vector<int>{3,4,6,3}, numClasses, inChannels);
         register_module("resnet", res34);
     }
     else if (ver == R50) {
-        res50 = std::make_shared<ResNet50Impl>(std::vector<int>{3,4,6,3}, numClasses);
+        res50 = std::make_shared<ResNet50Impl>(std::vector<int>{3,4,6,3}, numClasses, inChannels);
         register_module("resnet", res50);
     }
     else if (ver == R101) {
-        res101 = std::make_shared<ResNet101Impl>(std::vector<int>{3,4,23,3}, numClasses);
+        res101 = std::make_shared<ResNet101Impl>(std::vector<int>{3,4,23,3}, numClasses, inChannels);
         register_module("resnet", res101);
     }
     else {  // R152
-        res152 = std::make_shared<ResNet152Impl>(std::vector<int>{3,8,36,3}, numClasses);
+        res152 = std::make_shared<ResNet152Impl>(std::vector<int>{3,8,36,3}, numClasses, inChannels);
         register_module("resnet", res152);
     }
 }
@@ -45,5 +45,48 @@ torch::Tensor ResNet::predict(const torch::Tensor& input) {
     return res18->forward(input);
 }
 
+torch::Tensor ResNet::embed(const torch::Tensor& input) {
+    switch (version_) {
+        case R18: return res18->embed(input);
+        case R34: return res34->embed(input);
+        case R50: return res50->embed(input);
+        case R101: return res101->embed(input);
+        case R152: return res152->embed(input);
+    }
+    return res18->embed(input);
+}
+
+torch::nn::Linear ResNet::head() {
+    switch (version_) {
+        case R18: return res18->head();
+        case R34: return res34->head();
+        case R50: return res50->head();
+        case R101: return res101->head();
+        case R152: return res152->head();
+    }
+    return res18->head();
+}
+
+void ResNet::resetHead(int numClasses) {
+    switch (version_) {
+        case R18: res18->resetHead(numClasses); break;
+        case R34: res34->resetHead(numClasses); break;
+        case R50: res50->resetHead(numClasses); break;
+        case R101: res101->resetHead(numClasses); break;
+        case R152: res152->resetHead(numClasses); break;
+    }
+}
+
+void ResNet::fuseForInference() {
+    switch (version_) {
+        case R18: res18->fuseStem(); break;
+        case R34: res34->fuseStem(); break;
+        case R50: res50->fuseStem(); break;
+        case R101: res101->fuseStem(); break;
+        case R152: res152->fuseStem(); break;
+    }
+    BaseModel::fuseForInference();
+}
+
 } // namespace models
 } // namespace med
@@ -14,11 +14,11 @@ template <class Block>
 class ResNetImpl : public torch::nn::Module {
 public:
     // Constructor
-    ResNetImpl(const std::vector<int>& layers, int numClasses=1000)
+    ResNetImpl(const std::vector<int>& layers, int numClasses=1000, int inChannels=3)
     : relu(torch::nn::ReLUOptions(true)),
       maxpool(torch::nn::MaxPool2dOptions(3).stride(2).padding(1)),
       avgpool(torch::nn::AdaptiveAvgPool2dOptions({1,1})) {
-        conv1 = register_module("conv1", torch::nn::Conv2d(torch::nn::Conv2dOptions(3, 64, 7).stride(2).padding(3).bias(false)));
+        conv1 = register_module("conv1", torch::nn::Conv2d(torch::nn::Conv2dOptions(inChannels, 64, 7).stride(2).padding(3).bias(false)));
         bn1 = register_module("bn1", torch::nn::BatchNorm2d(64));
         inplanes = 64;
 
@@ -32,14 +32,37 @@ public:
 
     // Forward pass
     torch::Tensor forward(torch::Tensor x) {
-        x = torch::relu(bn1->forward(conv1->forward(x)));
+        return fc->forward(embed(x));
+    }
+
+    // Backbone up to (and including) global pooling: [B, 512 * expansion]
+    torch::Tensor embed(torch::Tensor x) {
+        x = conv1->forward(x);
+        if (bn1) x = bn1->forward(x); // null once folded into conv1
+        x = torch::relu_(x);
         x = maxpool->forward(x);
         x = layer1->forward(x);
         x = layer2->forward(x);
         x = layer3->forward(x);
         x = layer4->forward(x);
-        x = avgpool->forward(x).view({x.size(0), -1});
-        return fc->forward(x);
+        return torch::flatten(avgpool->forward(x), 1); // no batch size baked into traced graphs
+    }
+
+    // Classification head
+    torch::nn::Linear head() const { return fc; }
+
+    // New, randomly initialized fc with `numClasses` outputs (on fc's device)
+    void resetHead(int numClasses) {
+        auto device = fc->weight.device();
+        fc = replace_module("fc", torch::nn::Linear(fc->options.in_features(), numClasses));
+        fc->to(device);
+    }
+
+    // Fold bn1 into the stem conv (inference only)
+    void fuseStem() {
+        if (!bn1) return;
+        conv1 = replace_module("conv1", med::layers::foldConvBN(conv1, bn1));
+        bn1 = nullptr;
     }
 
 private:
@@ -83,12 +106,20 @@ class ResNet : public BaseModel {
 public:
     enum Version { R18, R34, R50, R101, R152 };
 
-    // Constructor
-    ResNet(Version ver, int numClasses = 1000, torch::Device device = torch::kCPU);
+    // Constructor; inChannels = 1 takes grayscale input directly
+    ResNet(Version ver, int numClasses = 1000, torch::Device device = torch::kCPU, int inChannels = 3);
 
     // Forward pass
     torch::Tensor predict(const torch::Tensor& input) override;
 
+    // Pooled features before fc / the fc layer itself
+    torch::Tensor embed(const torch::Tensor& input) override;
+    torch::nn::Linear head() override;
+    void resetHead(int numClasses) override;
+
+    // Stem plus every residual block
+    void fuseForInference() override;
+
 private:
     Version version_;
     std::shared_ptr<ResNet18Impl> res18;
@@ -0,0 +1,94 @@
+#include "ScriptedModel.hpp"
+#include "common/Exception.hpp"
+#include <torch/csrc/jit/frontend/tracer.h>
+#include <sstream>
+
+namespace med {
+namespace models {
+
+namespace {
+
+// Extra file of the artifact holding the traced "H W"
+constexpr const char* kInputSizeFile = "input_size";
+
+std::string formatSize(const std::vector<int64_t>& size) {
+    return size.size() == 2 ? std::to_string(size[0]) + " " + std::to_string(size[1]) : std::string();
+}
+
+} // namespace
+
+ScriptedModel::ScriptedModel(const std::string& path, torch::Device device)
+: BaseModel("Scripted", device) {
+    loadModel(path);
+}
+
+void ScriptedModel::exportModel(BaseModel& model, const torch::Tensor& example, const std::string& path) {
+    model.eval();
+    torch::NoGradGuard noGrad;
+
+    // The tracer records weights as graph constants, which must not require grad
+    std::vector<std::pair<torch::Tensor, bool>> flags;
+    for (auto& p : model.parameters()) {
+        flags.emplace_back(p, p.requires_grad());
+        p.requires_grad_(false);
+    }
+
+    std::shared_ptr<torch::jit::Graph> graph;
+    try {
+        auto traced = torch::jit::tracer::trace(
+            {example},
+            [&model](torch::jit::Stack inputs) -> torch::jit::Stack {
+                return {model.predict(inputs[0].toTensor())};
+            },
+            [](const torch::autograd::Variable&) { return std::string(); });
+        graph = traced.first->graph;
+    } catch (const c10::Error& e) {
+        for (auto& [p, flag] : flags) p.requires_grad_(flag);
+        throw error::ModelException(std::string("tracing failed: ") + e.what_without_backtrace());
+    }
+    for (auto& [p, flag] : flags) p.requires_grad_(flag);
+
+    // Wrap the graph as the forward method of a fresh module (what torch.jit.trace does)
+    auto cu = std::make_shared<torch::jit::CompilationUnit>();
+    torch::jit::Module traced(c10::QualifiedName("__torch__.med.Exported"), cu);
+    traced.register_attribute("training", c10::BoolType::get(), false);
+    graph->insertInput(0, "self")->setType(traced._ivalue()->type());
+    auto* forward = cu->create_function(c10::QualifiedName("__torch__.med.Exported.forward"), graph);
+    traced.type()->addMethod(forward);
+
+    auto frozen = torch::jit::freeze(traced);
+    auto optimized = torch::jit::optimize_for_inference(frozen);
+    torch::jit::ExtraFilesMap extra{{kInputSizeFile, formatSize({example.size(2), example.size(3)})}};
+    try {
+        optimized.save(path, extra);
+    } catch (const c10::Error&) {
+        throw error::FileIOException(path, false);
+    }
+    std::cout << "[INFO] Exported frozen TorchScript model to " << path << "\n";
+}
+
+torch::Tensor ScriptedModel::predict(const torch::Tensor& input) {
+    return module.forward({input}).toTensor();
+}
+
+void ScriptedModel::saveModel(const std::string& filename) const {
+    module.save(filename, {{kInputSizeFile, formatSize(tracedSize)}});
+    std::cout << "[" << name << "] Saved model to " << filename << "\n";
+}
+
+void ScriptedModel::loadModel(const std::string& filename) {
+    torch::jit::ExtraFilesMap extra{{kInputSizeFile, ""}};
+    try {
+        module = torch::jit::load(filename, device, extra);
+    } catch (const c10::Error& e) {
+        throw error::ModelException("cannot load TorchScript model " + filename + ": " + e.what_without_backtrace());
+    }
+    tracedSize.clear();
+    std::istringstream size(extra[kInputSizeFile]);
+    int64_t h = 0, w = 0;
+    if (size >> h >> w) tracedSize = {h, w};
+    std::cout << "[" << name << "] Loaded model from " << filename << "\n";
+}
+
+} // namespace models
+} // namespace med
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "BaseModel.hpp"
+#include <string>
+#include <vector>
+#include <torch/script.h>
+#include <torch/torch.h>
+
+namespace med {
+namespace models {
+
+// A frozen TorchScript artifact behind the BaseModel interface, for deployment and for
+// running the existing evaluate() on an exported model. exportModel() traces predict()
+// of any model into a graph and freezes it (weights become constants), then applies
+// torch::jit::optimize_for_inference: constant folding, conv-BN folding, conv-add-ReLU
+// fusion and MKLDNN layouts on CPU. The graph is specialized to the spatial size of the
+// example input (the UNet skip padding is traced as constants); the batch size is free.
+// That size is stored next to the graph (extra file "input_size") and exposed by inputSize().
+class ScriptedModel : public BaseModel {
+public:
+    // Load an artifact written by exportModel()
+    ScriptedModel(const std::string& path, torch::Device device = torch::kCPU);
+
+    // Trace `model` on `example` ([B,C,H,W] on the model's device), freeze, optimize and
+    // save to `path`
+    static void exportModel(BaseModel& model, const torch::Tensor& example, const std::string& path);
+
+    // Forward pass of the scripted graph
+    torch::Tensor predict(const torch::Tensor& input) override;
+
+    // {H, W} the graph was traced at (empty for artifacts exported before it was recorded)
+    const std::vector<int64_t>& inputSize() const { return tracedSize; }
+
+    // The artifact is the whole model: save writes it again, load replaces it
+    void saveModel(const std::string& filename) const override;
+    void loadModel(const std::string& filename) override;
+
+private:
+    torch::jit::Module module;
+    std::vector<int64_t> tracedSize;
+};
+
+} // namespace models
+} // namespace med
@@ -1,45 +1,88 @@
 #include "UNet.hpp"
+#include <torch/csrc/jit/frontend/tracer.h>
+#include <algorithm>
+#include <cmath>
 
 namespace med {
 namespace models {
 
-UNetImpl::UNetImpl(int inChannels, int outChannels, torch::Device device)
-    : BaseModel("UNet", device),
-      inc(inChannels, 64),
-      down1(64, 128),
-      down2(128, 256),
-      down3(256, 512),
-      down4(512, 1024),
-      up1(1024, 512),
-      up2(512, 256),
-      up3(256, 128),
-      up4(128, 64),
-      outc(64, outChannels)
+UNetImpl::UNetImpl(int inChannels, int outChannels, torch::Device device, const UNetOptions& options)
+    : BaseModel("UNet", device)
 {
-    // Register all submodules
-    register_module("inc", inc);
-    register_module("down1", down1);
-    register_module("down2", down2);
-    register_module("down3", down3);
-    register_module("down4", down4);
-    register_module("up1", up1);
-    register_module("up2", up2);
-    register_module("up3", up3);
-    register_module("up4", up4);
-    register_module("outc", outc);
+    const int depth = std::clamp(options.depth, 1, 4);
+    base = std::max(1, static_cast<int>(std::lround(64 * options.width)));
+
+    // Register all submodules (same names as the fixed four-level network)
+    inc = register_module("inc", med::layers::DoubleConv(inChannels, base, options.separable));
+    for (int i = 1; i <= depth; ++i) {
+        downs.push_back(register_module("down" + std::to_string(i),
+            med::layers::Down(base << (i - 1), base << i, options.separable)));
+    }
+    for (int i = 1; i <= depth; ++i) {
+        int level = depth - i; // output level of this block
+        ups.push_back(register_module("up" + std::to_string(i),
+            med::layers::Up(base << (level + 1), base << level, options.bilinear, options.separable)));
+    }
+    outc = register_module("outc", med::layers::OutConv(base, outChannels));
 }
 
 torch::Tensor UNetImpl::predict(const torch::Tensor& input) {
-    auto x1 = inc->forward(input);
-    auto x2 = down1->forward(x1);
-    auto x3 = down2->forward(x2);
-    auto x4 = down3->forward(x3);
-    auto x5 = down4->forward(x4);
-    auto y1 = up1->forward_(x5, x4);
-    auto y2 = up2->forward_(y1, x3);
-    auto y3 = up3->forward_(y2, x2);
-    auto y4 = up4->forward_(y3, x1);
-    return outc->forward(y4);
+    // Never while tracing: the arena views would be recorded as constants of a fixed shape
+    if (useArena && !is_training() && !torch::GradMode::is_enabled() && !torch::jit::tracer::isTracing()) {
+        std::unique_lock<std::mutex> lock(arenaMtx, std::try_to_lock);
+        if (lock.owns_lock()) return predictPlanned(input);
+    }
+    // Encoder, keeping every level for the skip connections
+    std::vector<torch::Tensor> skips{inc->forward(input)};
+    for (auto& down : downs) {
+        skips.push_back(down->forward(skips.back()));
+    }
+    // Decoder
+    auto y = skips.back();
+    for (size_t i = 0; i < ups.size(); ++i) {
+        y = ups[i]->forward_(y, skips[skips.size() - 2 - i]);
+    }
+    return outc->forward(y);
+}
+
+bool UNetImpl::setActivationArena(bool on) {
+    std::lock_guard<std::mutex> lock(arenaMtx);
+    useArena = on;
+    arena.clear();
+    reportedBytes = 0;
+    return true;
+}
+
+torch::Tensor UNetImpl::predictPlanned(const torch::Tensor& input) {
+    arena.begin(input);
+    auto format = input.suggest_memory_format();
+    const int64_t B = input.size(0);
+    int64_t H = input.size(2), W = input.size(3);
+
+    // Level l ends in the concat buffer [B, 2C, H, W] of the up block that consumes it;
+    // its skip is the first half, so the encoder output is never copied
+    std::vector<torch::Tensor> cats;
+    torch::Tensor x = input;
+    for (size_t l = 0; l < downs.size(); ++l, H /= 2, W /= 2) {
+        const int64_t C = static_cast<int64_t>(base) << l;
+        cats.push_back(arena.acquire({B, 2 * C, H, W}, input.options(), format));
+        auto skip = cats.back().narrow(1, 0, C);
+        x = l == 0 ? inc->forwardInto(x, skip) : downs[l - 1]->forwardInto(x, skip, arena);
+    }
+    auto y = downs.back()->forward(x);
+    for (size_t i = 0; i < ups.size(); ++i) {
+        auto& cat = cats[cats.size() - 1 - i];
+        y = ups[i]->forwardInto(y, cat);
+        arena.release(cat);
+    }
+    arena.end();
+    if (arena.plannedBytes() != reportedBytes) {
+        reportedBytes = arena.plannedBytes();
+        std::cout << "[" << name << "] Activation arena planned for input " << input.sizes() << ": "
+                  << reportedBytes / (1024.0 * 1024.0) << " MB shared block for " << arena.requestedBytes() / (1024.0 * 1024.0)
+                  << " MB of buffers (largest shape so far)\n";
+    }
+    return outc->forward(y);
 }
 
 } // namespace models
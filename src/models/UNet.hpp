@@ -1,31 +1,56 @@
 #pragma once
 
 #include "BaseModel.hpp"
+#include "layers/ActivationArena.hpp"
 #include "layers/DoubleConv.hpp"
 #include "layers/Down.hpp"
 #include "layers/Up.hpp"
 #include "layers/OutConv.hpp"
 #include <torch/torch.h>
+#include <mutex>
+#include <vector>
 
 namespace med {
     
 namespace models {
 
+// Shape of a UNet variant; the defaults are the original 64->1024, four-level network
+struct UNetOptions {
+    double width = 1.0;     // channel multiplier (level i has round(64 * width) * 2^i channels)
+    int depth = 4;          // down-sampling steps, 1-4
+    bool separable = false; // depthwise-separable DoubleConv
+    bool bilinear = false;  // bilinear upsampling instead of ConvTranspose2d
+};
+
 // UNet implementation class inheriting BaseModel
 class UNetImpl : public BaseModel {
 public:
     // Constructor
-    UNetImpl(int inChannels, int outChannels, torch::Device device = torch::kCPU);
+    UNetImpl(int inChannels, int outChannels, torch::Device device = torch::kCPU,
+             const UNetOptions& options = UNetOptions());
 
     // Forward pass
     torch::Tensor predict(const torch::Tensor& input) override;
 
+    // Skip connections are written by the encoder straight into the concat buffers of
+    // the decoder, which live in the arena with the pooling outputs
+    bool setActivationArena(bool on) override;
+
 private:
+    // predict() with every concat and pooling buffer taken from the arena
+    torch::Tensor predictPlanned(const torch::Tensor& input);
+
     // Layers
-    med::layers::DoubleConv inc;
-    med::layers::Down down1, down2, down3, down4;
-    med::layers::Up up1, up2, up3, up4;
-    med::layers::OutConv outc;
+    med::layers::DoubleConv inc{nullptr};
+    std::vector<med::layers::Down> downs; // registered as down1..downN
+    std::vector<med::layers::Up> ups;     // registered as up1..upN
+    med::layers::OutConv outc{nullptr};
+    int base = 64;                    // channels of level 0
+
+    bool useArena = false;
+    med::layers::ActivationArena arena;
+    size_t reportedBytes = 0;         // plannedBytes() when last printed
+    std::mutex arenaMtx;              // one planned pass at a time; others run unplanned
 };
 TORCH_MODULE(UNet);
 
@@ -0,0 +1,118 @@
+#include "WeightImporter.hpp"
+#include "common/Exception.hpp"
+#include <torch/csrc/jit/serialization/pickle.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <regex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace med {
+namespace models {
+
+std::string WeightImporter::mapName(common::ModelType type, const std::string& key) {
+    if (type == common::ModelType::ResNet) {
+        // Same module tree, one level down (ResNet registers its body as "resnet")
+        return "resnet." + key;
+    }
+    if (type != common::ModelType::DenseNet) {
+        return "";
+    }
+
+    // Older torchvision checkpoints spell "norm1" as "norm.1"
+    static const std::regex legacy(R"((norm|relu|conv)\.(\d)\.)");
+    std::string k = std::regex_replace(key, legacy, "$1$2.");
+
+    static const std::regex layer(R"(features\.denseblock(\d+)\.denselayer(\d+)\.(norm|conv)(\d)\.(.+))");
+    static const std::regex transition(R"(features\.transition(\d+)\.(norm|conv)\.(.+))");
+    std::smatch m;
+    if (std::regex_match(k, m, layer)) {
+        // Blocks and transitions alternate inside our "features" Sequential
+        int block = std::stoi(m[1]);
+        std::string kind = m[3] == "norm" ? "bn" : "conv";
+        return "features." + std::to_string(2 * (block - 1)) + ".denselayer_" + m[2].str()
+             + "." + kind + m[4].str() + "." + m[5].str();
+    }
+    if (std::regex_match(k, m, transition)) {
+        int block = std::stoi(m[1]);
+        std::string kind = m[2] == "norm" ? "bn" : "conv";
+        return "features." + std::to_string(2 * block - 1) + "." + kind + "." + m[3].str();
+    }
+    static const std::pair<const char*, const char*> prefixes[] = {
+        {"features.conv0.", "init_conv."},
+        {"features.norm0.", "init_bn."},
+        {"features.norm5.", "final_bn."},
+        {"classifier.", "classifier."},
+    };
+    for (const auto& [from, to] : prefixes) {
+        std::string f(from);
+        if (k.compare(0, f.size(), f) == 0) return to + k.substr(f.size());
+    }
+    return "";
+}
+
+size_t WeightImporter::importTorchvision(BaseModel& model, common::ModelType type, const std::string& path) {
+    if (type != common::ModelType::ResNet && type != common::ModelType::DenseNet) {
+        throw error::ConfigException("--pretrained", "only ResNet and DenseNet weights can be imported");
+    }
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw error::FileIOException(path, true);
+    }
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    torch::IValue loaded;
+    try {
+        loaded = torch::pickle_load(bytes);
+    } catch (const c10::Error& e) {
+        throw error::ModelException("cannot read state dict " + path + ": " + e.what_without_backtrace());
+    }
+    if (!loaded.isGenericDict()) {
+        throw error::ModelException(path + " is not a state dict");
+    }
+
+    // Our tensors by name (DenseBlock registers each layer twice; either name will do)
+    std::unordered_map<std::string, torch::Tensor> ours;
+    for (const auto& item : model.named_parameters()) ours[item.key()] = item.value();
+    for (const auto& item : model.named_buffers()) ours[item.key()] = item.value();
+
+    torch::NoGradGuard noGrad;
+    std::unordered_set<const void*> filled;
+    size_t skipped = 0;
+    for (const auto& entry : loaded.toGenericDict()) {
+        std::string key = entry.key().toStringRef();
+        if (!entry.value().isTensor()) continue;
+        auto it = ours.find(mapName(type, key));
+        if (it == ours.end()) {
+            ++skipped;
+            continue;
+        }
+        torch::Tensor src = entry.value().toTensor();
+        torch::Tensor& dst = it->second;
+
+        // Single-channel stem: fold the RGB filters into one (same response to gray input)
+        if (src.dim() == 4 && dst.dim() == 4 && src.size(1) == 3 && dst.size(1) == 1) {
+            src = src.sum(1, /*keepdim=*/true);
+        }
+        if (src.sizes() != dst.sizes()) {
+            std::cout << "[INFO] Pretrained " << key << " has shape " << src.sizes()
+                      << ", model expects " << dst.sizes() << "; keeping random init\n";
+            ++skipped;
+            continue;
+        }
+        // copy_ keeps our device, dtype and memory format
+        dst.copy_(src);
+        filled.insert(dst.unsafeGetTensorImpl());
+    }
+
+    // Count distinct tensors (each DenseBlock tensor appears under two names)
+    std::unordered_set<const void*> total;
+    for (const auto& [name, t] : ours) total.insert(t.unsafeGetTensorImpl());
+    std::cout << "[INFO] Imported " << filled.size() << "/" << total.size()
+              << " tensors from " << path << " (" << skipped << " skipped)\n";
+    return filled.size();
+}
+
+} // namespace models
+} // namespace med
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "BaseModel.hpp"
+#include "common/ArgParser.hpp"
+#include <string>
+#include <torch/torch.h>
+
+namespace med {
+namespace models {
+
+// Imports torchvision ResNet / DenseNet weights (a state dict written by
+// torch.save(model.state_dict())) into our module layout. Tensors whose shape does not
+// match are skipped, except the stem conv, whose RGB filters are summed when our model
+// takes a single input channel. A classifier with a different class count stays at its
+// random init.
+class WeightImporter {
+public:
+    // Copy every matching tensor of the state dict in `path` into `model`; returns how
+    // many of the model's tensors were filled
+    static size_t importTorchvision(BaseModel& model, common::ModelType type, const std::string& path);
+
+    // Our parameter/buffer name for a torchvision state-dict key ("" if there is none)
+    static std::string mapName(common::ModelType type, const std::string& key);
+};
+
+} // namespace models
+} // namespace med
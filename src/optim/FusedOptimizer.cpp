@@ -0,0 +1,246 @@
+#include "FusedOptimizer.hpp"
+#include "common/Exception.hpp"
+#include <ATen/Parallel.h>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace med {
+namespace optim {
+
+namespace {
+constexpr int64_t kGrain = 1 << 15; // elements per parallel work item
+}
+
+FusedOptions optionsFromConfig(const common::Config& cfg) {
+    FusedOptions options;
+    options.type = cfg.optimizer;
+    options.lr = cfg.learningRate;
+    options.weightDecay = cfg.weightDecay;
+    options.momentum = cfg.momentum;
+    return options;
+}
+
+FusedOptimizer::FusedOptimizer(const std::vector<torch::Tensor>& params, FusedOptions options)
+: opts(options) {
+    torch::NoGradGuard noGrad;
+
+    // Deduplicate (modules may be registered under two names) and group by device/dtype
+    std::unordered_set<const void*> seen;
+    std::vector<std::vector<torch::Tensor>> buckets;
+    for (const auto& p : params) {
+        if (!p.requires_grad() || !seen.insert(p.unsafeGetTensorImpl()).second) continue;
+        size_t b = 0;
+        while (b < buckets.size() && !(buckets[b][0].device() == p.device() && buckets[b][0].scalar_type() == p.scalar_type())) ++b;
+        if (b == buckets.size()) buckets.emplace_back();
+        buckets[b].push_back(p);
+    }
+
+    for (auto& bucket : buckets) {
+        Group g;
+        int64_t total = 0;
+        for (const auto& p : bucket) total += p.numel();
+
+        auto options_ = bucket[0].options().requires_grad(false);
+        g.flatParams = torch::empty({total}, options_);
+        g.flatGrads = torch::zeros({total}, options_);
+        g.expAvg = torch::zeros({total}, options_);
+        if (opts.type != common::OptimizerType::SGD) {
+            g.expAvgSq = torch::zeros({total}, options_);
+        }
+
+        // Re-bind every parameter (and its gradient) as a view into the flat buffers,
+        // keeping its memory layout (e.g. channels-last) when it is dense
+        int64_t offset = 0;
+        for (auto& p : bucket) {
+            bindParam(g, p, offset);
+            g.offsets.push_back(offset);
+            offset += p.numel();
+        }
+        g.params = std::move(bucket);
+        groups.push_back(std::move(g));
+    }
+}
+
+void FusedOptimizer::bindParam(Group& g, torch::Tensor& p, int64_t offset) {
+    torch::Tensor src = p.detach();
+    if (!src.is_non_overlapping_and_dense()) src = src.contiguous();
+    auto paramView = g.flatParams.as_strided(src.sizes(), src.strides(), offset);
+    auto gradView = g.flatGrads.as_strided(src.sizes(), src.strides(), offset);
+    paramView.copy_(src);
+    p.set_data(paramView);
+    if (!p.grad().defined()) {
+        gradView.zero_(); // e.g. reset to none: no gradient yet
+    } else if (!p.grad().is_same(gradView)) {
+        gradView.copy_(p.grad());
+    }
+    p.mutable_grad() = gradView;
+}
+
+void FusedOptimizer::rebind(Group& g) {
+    const auto* paramBase = static_cast<const char*>(g.flatParams.data_ptr());
+    const auto* gradBase = static_cast<const char*>(g.flatGrads.data_ptr());
+    const size_t itemSize = g.flatParams.element_size();
+    size_t rebound = 0;
+    for (size_t k = 0; k < g.params.size(); ++k) {
+        auto& p = g.params[k];
+        const size_t byteOffset = static_cast<size_t>(g.offsets[k]) * itemSize;
+        const bool paramBound = p.data_ptr() == paramBase + byteOffset;
+        const bool gradBound = p.grad().defined() && p.grad().data_ptr() == gradBase + byteOffset;
+        if (paramBound && gradBound) continue;
+
+        const int64_t expected = (k + 1 < g.params.size() ? g.offsets[k + 1] : g.flatParams.numel()) - g.offsets[k];
+        if (p.numel() != expected || p.device() != g.flatParams.device() ||
+            p.scalar_type() != g.flatParams.scalar_type()) {
+            throw error::ModelException("a parameter changed size, dtype or device after the optimizer was built");
+        }
+        bindParam(g, p, g.offsets[k]);
+        ++rebound;
+    }
+    if (rebound > 0) {
+        std::cerr << "[WARN] FusedOptimizer: " << rebound << " parameter(s) were re-bound outside the optimizer; "
+                  << "their current values were copied back into the flat buffer\n";
+    }
+}
+
+void FusedOptimizer::zero_grad() {
+    for (auto& g : groups) {
+        g.flatGrads.zero_();
+    }
+}
+
+void FusedOptimizer::scaleGradients(double factor) {
+    for (auto& g : groups) {
+        g.flatGrads.mul_(factor);
+    }
+}
+
+void FusedOptimizer::step() {
+    torch::NoGradGuard noGrad;
+    ++steps;
+    for (auto& g : groups) {
+        rebind(g);
+        if (g.flatParams.device().is_cpu() && g.flatParams.scalar_type() == torch::kFloat) {
+            stepCPU(g);
+        } else {
+            stepGeneric(g);
+        }
+    }
+}
+
+// One pass per element: decay, moments and update are fused; chunks run in parallel
+void FusedOptimizer::stepCPU(Group& g) {
+    const int64_t n = g.flatParams.numel();
+    float* p = g.flatParams.data_ptr<float>();
+    const float* grad = g.flatGrads.data_ptr<float>();
+    float* m = g.expAvg.data_ptr<float>();
+
+    const float lr = static_cast<float>(opts.lr);
+    const float wd = static_cast<float>(opts.weightDecay);
+
+    if (opts.type == common::OptimizerType::SGD) {
+        const float mom = static_cast<float>(opts.momentum);
+        // buf starts at zero, so the first step gives buf = g like torch::optim::SGD
+        at::parallel_for(0, n, kGrain, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+                const float gi = grad[i] + wd * p[i];
+                m[i] = mom * m[i] + gi;
+                p[i] -= lr * m[i];
+            }
+        });
+        return;
+    }
+
+    float* v = g.expAvgSq.data_ptr<float>();
+    const bool decoupled = opts.type == common::OptimizerType::AdamW;
+    const float b1 = static_cast<float>(opts.beta1);
+    const float b2 = static_cast<float>(opts.beta2);
+    const float eps = static_cast<float>(opts.eps);
+    const double bc1 = 1.0 - std::pow(opts.beta1, static_cast<double>(steps));
+    const double bc2 = 1.0 - std::pow(opts.beta2, static_cast<double>(steps));
+    const float stepSize = static_cast<float>(opts.lr / bc1);
+    const float invSqrtBc2 = static_cast<float>(1.0 / std::sqrt(bc2));
+    const float l2 = decoupled ? 0.f : wd;
+    const float decay = decoupled ? 1.f - lr * wd : 1.f;
+
+    at::parallel_for(0, n, kGrain, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            const float pi = p[i] * decay;
+            const float gi = grad[i] + l2 * pi;
+            const float mi = b1 * m[i] + (1.f - b1) * gi;
+            const float vi = b2 * v[i] + (1.f - b2) * gi * gi;
+            m[i] = mi;
+            v[i] = vi;
+            p[i] = pi - stepSize * mi / (std::sqrt(vi) * invSqrtBc2 + eps);
+        }
+    });
+}
+
+// Same update with whole-buffer tensor ops (CUDA, non-float): a few kernels per group
+void FusedOptimizer::stepGeneric(Group& g) {
+    if (opts.type == common::OptimizerType::SGD) {
+        auto grad = opts.weightDecay != 0.0 ? g.flatGrads.add(g.flatParams, opts.weightDecay) : g.flatGrads;
+        g.expAvg.mul_(opts.momentum).add_(grad);
+        g.flatParams.add_(g.expAvg, -opts.lr);
+        return;
+    }
+
+    const bool decoupled = opts.type == common::OptimizerType::AdamW;
+    if (decoupled && opts.weightDecay != 0.0) {
+        g.flatParams.mul_(1.0 - opts.lr * opts.weightDecay);
+    }
+    auto grad = (!decoupled && opts.weightDecay != 0.0) ? g.flatGrads.add(g.flatParams, opts.weightDecay) : g.flatGrads;
+
+    const double bc1 = 1.0 - std::pow(opts.beta1, static_cast<double>(steps));
+    const double bc2 = 1.0 - std::pow(opts.beta2, static_cast<double>(steps));
+    g.expAvg.mul_(opts.beta1).add_(grad, 1.0 - opts.beta1);
+    g.expAvgSq.mul_(opts.beta2).addcmul_(grad, grad, 1.0 - opts.beta2);
+    auto denom = (g.expAvgSq.sqrt() / std::sqrt(bc2)).add_(opts.eps);
+    g.flatParams.addcdiv_(g.expAvg, denom, -opts.lr / bc1);
+}
+
+std::vector<std::pair<std::string, torch::Tensor>> FusedOptimizer::stateTensors() const {
+    auto hostCopy = [](const torch::Tensor& t) {
+        return t.detach().to(torch::kCPU, /*non_blocking=*/false, /*copy=*/true);
+    };
+    std::vector<std::pair<std::string, torch::Tensor>> out;
+    out.emplace_back("step", torch::tensor(steps, torch::kLong));
+    for (size_t i = 0; i < groups.size(); ++i) {
+        std::string prefix = "group" + std::to_string(i) + ".";
+        out.emplace_back(prefix + "exp_avg", hostCopy(groups[i].expAvg));
+        if (groups[i].expAvgSq.defined()) {
+            out.emplace_back(prefix + "exp_avg_sq", hostCopy(groups[i].expAvgSq));
+        }
+    }
+    return out;
+}
+
+void FusedOptimizer::loadStateTensors(const std::vector<std::pair<std::string, torch::Tensor>>& tensors) {
+    torch::NoGradGuard noGrad;
+    std::unordered_map<std::string, torch::Tensor> byName(tensors.begin(), tensors.end());
+
+    auto step = byName.find("step");
+    if (step == byName.end()) {
+        throw error::ModelException("optimizer state has no step counter");
+    }
+    steps = step->second.item<int64_t>();
+
+    auto load = [&](const std::string& name, torch::Tensor& dst) {
+        auto it = byName.find(name);
+        if (it == byName.end() || it->second.numel() != dst.numel()) {
+            throw error::ModelException("optimizer state '" + name + "' does not match the model/optimizer");
+        }
+        dst.copy_(it->second);
+    };
+    for (size_t i = 0; i < groups.size(); ++i) {
+        std::string prefix = "group" + std::to_string(i) + ".";
+        load(prefix + "exp_avg", groups[i].expAvg);
+        if (groups[i].expAvgSq.defined()) {
+            load(prefix + "exp_avg_sq", groups[i].expAvgSq);
+        }
+    }
+}
+
+} // namespace optim
+} // namespace med
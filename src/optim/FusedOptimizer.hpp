@@ -0,0 +1,80 @@
+#pragma once
+
+#include "common/ArgParser.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+#include <torch/torch.h>
+
+namespace med {
+namespace optim {
+
+// Hyperparameters of FusedOptimizer
+struct FusedOptions {
+    common::OptimizerType type = common::OptimizerType::Adam;
+    double lr = 1e-3;
+    double beta1 = 0.9;
+    double beta2 = 0.999;
+    double eps = 1e-8;
+    double weightDecay = 0.0;   // L2 penalty (Adam, SGD) or decoupled decay (AdamW)
+    double momentum = 0.9;      // SGD only
+};
+
+// Optimizer type, learning rate, weight decay and momentum taken from the CLI config
+FusedOptions optionsFromConfig(const common::Config& cfg);
+
+// Multi-tensor Adam / AdamW / SGD-momentum.
+// All parameters (and their gradients) are re-bound as views into a few contiguous
+// buffers, one per (device, dtype), so a step is one fused, multithreaded sweep over
+// each buffer instead of a handful of small kernels per parameter tensor. step()
+// checks that every parameter still aliases its buffer and re-binds those that do not.
+class FusedOptimizer {
+public:
+    FusedOptimizer(const std::vector<torch::Tensor>& params, FusedOptions options);
+
+    // Zero the flat gradient buffers in place (gradients stay bound to them)
+    void zero_grad();
+
+    // Multiply every gradient by `factor` (one op per flat buffer)
+    void scaleGradients(double factor);
+
+    // One update of every parameter
+    void step();
+
+    // Optimizer state as (name, host copy) pairs, for checkpoints
+    std::vector<std::pair<std::string, torch::Tensor>> stateTensors() const;
+
+    // Restore state produced by stateTensors()
+    void loadStateTensors(const std::vector<std::pair<std::string, torch::Tensor>>& tensors);
+
+    const FusedOptions& options() const { return opts; }
+
+private:
+    // Parameters sharing one device and dtype, flattened into contiguous buffers
+    struct Group {
+        std::vector<torch::Tensor> params;
+        std::vector<int64_t> offsets; // element offset of each param in the flat buffers
+        torch::Tensor flatParams;
+        torch::Tensor flatGrads;
+        torch::Tensor expAvg;       // Adam/AdamW first moment, SGD momentum buffer
+        torch::Tensor expAvgSq;     // Adam/AdamW second moment
+    };
+
+    // Re-bind params (and gradients) that no longer alias the flat buffers, e.g. after
+    // set_data() from a weight load, keeping their current values; throws if a param
+    // changed its size, dtype or device
+    void rebind(Group& g);
+
+    // Copy `p` (and its gradient) into the buffers at `offset` and re-bind it as views there
+    static void bindParam(Group& g, torch::Tensor& p, int64_t offset);
+
+    void stepCPU(Group& g);
+    void stepGeneric(Group& g);
+
+    FusedOptions opts;
+    std::vector<Group> groups;
+    int64_t steps = 0;
+};
+
+} // namespace optim
+} // namespace med
@@ -0,0 +1,110 @@
+// src/runners/client.cpp
+// Load-test client for "med-cxx serve": sends the images of a directory (round robin)
+// over N concurrent connections and reports throughput and latency percentiles.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "serving/Protocol.hpp"
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: med-cxx-client <image-dir> [options]\n"
+                  << "  --socket <path>          Server Unix socket (default /tmp/medcxx.sock)\n"
+                  << "  --port <N>               Connect to localhost:N instead\n"
+                  << "  --concurrency <N>        Parallel connections (default 8)\n"
+                  << "  --requests <N>           Requests in total (default 1000)\n";
+        return EXIT_FAILURE;
+    }
+    std::string imageDir = argv[1];
+    std::string socketPath = "/tmp/medcxx.sock";
+    int port = 0;
+    size_t concurrency = 8, numRequests = 1000;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i+1 < argc) socketPath = argv[++i];
+        else if (arg == "--port" && i+1 < argc) port = std::stoi(argv[++i]);
+        else if (arg == "--concurrency" && i+1 < argc) concurrency = std::max<size_t>(1, std::stoul(argv[++i]));
+        else if (arg == "--requests" && i+1 < argc) numRequests = std::max<size_t>(1, std::stoul(argv[++i]));
+        else std::cerr << "[WARN] Ignoring argument " << arg << "\n";
+    }
+
+    // Encoded files are sent as they are; the server decodes them
+    std::vector<std::vector<char>> images;
+    for (auto& p : fs::directory_iterator(imageDir)) {
+        if (!p.is_regular_file()) continue;
+        std::ifstream in(p.path(), std::ios::binary);
+        images.emplace_back((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+    if (images.empty()) {
+        std::cerr << "[ERROR] No files in " << imageDir << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> failed{0};
+    std::mutex mtx;
+    std::vector<double> latenciesMs;
+    auto start = Clock::now();
+
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < concurrency; ++w) {
+        workers.emplace_back([&] {
+            int fd = med::serving::connectTo(socketPath, port);
+            if (fd < 0) {
+                std::cerr << "[ERROR] Cannot connect to the server\n";
+                return;
+            }
+            std::vector<double> mine;
+            std::vector<float> output;
+            for (size_t i = next++; i < numRequests; i = next++) {
+                const auto& img = images[i % images.size()];
+                med::serving::RequestHeader req{med::serving::kRequestMagic, static_cast<uint32_t>(img.size())};
+                med::serving::ResponseHeader resp;
+                auto sent = Clock::now();
+                if (!med::serving::writeAll(fd, &req, sizeof(req)) ||
+                    !med::serving::writeAll(fd, img.data(), img.size()) ||
+                    !med::serving::readAll(fd, &resp, sizeof(resp))) {
+                    ++failed;
+                    break;
+                }
+                output.resize(resp.count);
+                if (resp.count > 0 && !med::serving::readAll(fd, output.data(), resp.count * sizeof(float))) {
+                    ++failed;
+                    break;
+                }
+                if (resp.status != med::serving::kOk) ++failed;
+                mine.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sent).count());
+            }
+            ::close(fd);
+            std::lock_guard<std::mutex> lock(mtx);
+            latenciesMs.insert(latenciesMs.end(), mine.begin(), mine.end());
+        });
+    }
+    for (auto& t : workers) t.join();
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (latenciesMs.empty()) {
+        std::cerr << "[ERROR] No request completed\n";
+        return EXIT_FAILURE;
+    }
+    std::sort(latenciesMs.begin(), latenciesMs.end());
+    auto pct = [&](double q) {
+        return latenciesMs[std::min(latenciesMs.size() - 1, static_cast<size_t>(q * latenciesMs.size()))];
+    };
+    std::cout << "[BENCH] " << latenciesMs.size() << " requests over " << concurrency << " connections in "
+              << seconds << " s: " << latenciesMs.size() / seconds << " req/s, latency p50 " << pct(0.50)
+              << " ms, p99 " << pct(0.99) << " ms, " << failed << " failed\n";
+    return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,4 +1,5 @@
 // src/runners/main.cpp
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <filesystem>
@@ -6,11 +7,16 @@
 
 #include "common/ArgParser.hpp"
 #include "common/Exception.hpp"
+#include "common/Runtime.hpp"
+#include "evaluation/Profiler.hpp"
+#include "trainer/Autotuner.hpp"
 #include "trainer/SegmentationTrainer.hpp"
 #include "trainer/ClassificationTrainer.hpp"
-#include "models/UNet.hpp"
-#include "models/DenseNet.hpp"
-#include "models/ResNet.hpp"
+#include "models/MappedWeights.hpp"
+#include "models/ModelFactory.hpp"
+#include "models/ScriptedModel.hpp"
+#include "models/WeightImporter.hpp"
+#include "serving/InferenceServer.hpp"
 
 namespace fs = std::filesystem;
 
@@ -28,18 +34,86 @@ int main(int argc, char** argv) {
         std::cout << "  clsTestDir     =  \"" << cfg.clsTestDir << "\"\n";
         std::cout << "  modelName      =  \"" << cfg.modelName << "\"\n";
         std::cout << "  epochs         =  "   << cfg.epochs << "\n";
+        std::cout << "  optimizer      =  "   << (cfg.optimizer == med::common::OptimizerType::SGD ? "sgd" :
+                                                     cfg.optimizer == med::common::OptimizerType::AdamW ? "adamw" : "adam") << "\n";
+        std::cout << "  weightDecay    =  "   << cfg.weightDecay << "\n";
+        std::cout << "  momentum       =  "   << cfg.momentum << "\n";
+        std::cout << "  batchSize      =  "   << cfg.batchSize << "\n";
+        std::cout << "  evalBatchSize  =  "   << cfg.evalBatchSize << "\n";
+        std::cout << "  accumSteps     =  "   << cfg.accumulateSteps << "\n";
+        std::cout << "  channelsLast   =  "   << (cfg.channelsLast ? "true" : "false") << "\n";
+        std::cout << "  imageSize      =  "   << cfg.imageSize << "\n";
+        std::cout << "  resizeSchedule =  "   << cfg.resizeSchedule.size() << " stage(s)\n";
+        std::cout << "  trainCrop      =  "   << cfg.trainCrop << "\n";
+        std::cout << "  importanceSamp =  "   << (cfg.importanceSampling ? "true" : "false") << "\n";
+        std::cout << "  isWarmup       =  "   << cfg.isWarmupEpochs << "\n";
+        std::cout << "  isFraction     =  "   << cfg.isFraction << "\n";
+        std::cout << "  isMix          =  "   << cfg.isUniformMix << "\n";
+        std::cout << "  teacher        =  \"" << cfg.teacherPath << "\"\n";
+        std::cout << "  distillAlpha   =  "   << cfg.distillAlpha << "\n";
+        std::cout << "  distillTemp    =  "   << cfg.distillTemperature << "\n";
+        std::cout << "  headOnly       =  "   << (cfg.headOnly ? "true" : "false") << "\n";
+        std::cout << "  featureCache   =  \"" << cfg.featureCachePath << "\"\n";
+        std::cout << "  autotune       =  "   << (cfg.autotune ? "true" : "false") << "\n";
+        std::cout << "  autotuneCache  =  \"" << cfg.autotuneCache << "\"\n";
+        std::cout << "  memBudgetMB    =  "   << cfg.autotuneMemoryMB << "\n";
+        std::cout << "  ckptEvery      =  "   << cfg.checkpointEvery << "\n";
+        std::cout << "  ckptPath       =  \"" << cfg.checkpointPath << "\"\n";
+        std::cout << "  resumePath     =  \"" << cfg.resumePath << "\"\n";
+        std::cout << "  valSplit       =  "   << cfg.valSplit << "\n";
+        std::cout << "  valEvery       =  "   << cfg.valEvery << "\n";
+        std::cout << "  earlyStop      =  "   << cfg.earlyStopPatience << "\n";
+        std::cout << "  intraOpThreads =  "   << cfg.intraOpThreads << "\n";
+        std::cout << "  interOpThreads =  "   << cfg.interOpThreads << "\n";
+        std::cout << "  cvThreads      =  "   << cfg.cvThreads << "\n";
+        std::cout << "  loaderWorkers  =  "   << cfg.loaderWorkers << "\n";
+        std::cout << "  computeCores   =  \"" << cfg.computeCores << "\"\n";
+        std::cout << "  loaderCores    =  \"" << cfg.loaderCores << "\"\n";
+        std::cout << "  ioCores        =  \"" << cfg.ioCores << "\"\n";
+        std::cout << "  videoCores     =  \"" << cfg.videoCores << "\"\n";
+        std::cout << "  numaNode       =  "   << cfg.numaNode << "\n";
+        std::cout << "  targetScore    =  "   << cfg.targetScore << "\n";
         std::cout << "  useCUDA        =  "   << (cfg.useCUDA ? "true" : "false") << "\n";
         std::cout << "  bceWeight      =  "   << cfg.bcePosWeight << "\n";
+        std::cout << "  unetWidth      =  "   << cfg.unetWidth << "\n";
+        std::cout << "  unetDepth      =  "   << cfg.unetDepth << "\n";
+        std::cout << "  separable      =  "   << (cfg.unetSeparable ? "true" : "false") << "\n";
+        std::cout << "  bilinear       =  "   << (cfg.unetBilinear ? "true" : "false") << "\n";
+        std::cout << "  profile        =  "   << (cfg.profileModel ? "true" : "false") << "\n";
+        std::cout << "  foldBN         =  "   << (cfg.foldBN ? "true" : "false") << "\n";
+        std::cout << "  quantize       =  "   << (cfg.quantize ? "true" : "false") << "\n";
+        std::cout << "  int8           =  "   << (cfg.int8 ? "true" : "false") << "\n";
+        std::cout << "  calibSamples   =  "   << cfg.calibSamples << "\n";
+        std::cout << "  arena          =  "   << (cfg.activationArena ? "true" : "false") << "\n";
+        std::cout << "  serve          =  "   << (cfg.serve ? "true" : "false") << "\n";
+        std::cout << "  serveSocket    =  \"" << cfg.serveSocket << "\"\n";
+        std::cout << "  servePort      =  "   << cfg.servePort << "\n";
+        std::cout << "  serveMaxBatch  =  "   << cfg.serveMaxBatch << "\n";
+        std::cout << "  serveMaxWaitMs =  "   << cfg.serveMaxWaitMs << "\n";
+        std::cout << "  tileSize       =  "   << cfg.tileSize << "\n";
+        std::cout << "  tileStride     =  "   << cfg.tileStride << "\n";
+        std::cout << "  tileBlend      =  "   << (cfg.tileBlend == med::common::TileBlend::Gaussian ? "gaussian" : "linear") << "\n";
+        std::cout << "  ttaViews       =  "   << cfg.ttaViews << "\n";
         std::cout << "  skipTraining   =  "   << (cfg.skipTraining ? "true" : "false") << "\n";
         std::cout << "  modelWeights   =  \"" << cfg.modelWeightsPath << "\"\n";
+        std::cout << "  pretrained     =  \"" << cfg.pretrainedPath << "\"\n";
+        std::cout << "  export         =  \"" << cfg.exportPath << "\"\n";
+        std::cout << "  scripted       =  \"" << cfg.scriptedPath << "\"\n";
+        std::cout << "  saveMapped     =  \"" << cfg.mappedPath << "\"\n";
         std::cout << "  deviceStr      =  \"" << cfg.deviceStr << "\"\n";
         std::cout << "  resnetVersion  =  "   << static_cast<int>(cfg.resnetVersion) << "\n";
+        std::cout << "  inChannels     =  "   << cfg.inChannels << "\n";
         std::cout << "  makeVideo      =  "   << (cfg.makeVideo ? "true" : "false") << "\n";
         std::cout << "  videoFPS       =  "   << cfg.videoFPS << "\n";
         std::cout << "  holdFrames     =  "   << cfg.holdFrames << "\n";
         std::cout << "  printBarWidth  =  "   << cfg.printBarWidth << "\n";
+        std::cout << "  logEvery       =  "   << cfg.logEvery << "\n";
+        std::cout << "  progressMs     =  "   << cfg.progressIntervalMs << "\n";
         std::cout << "> End of configuration.\n\n";
 
+        // Thread counts, core pinning and NUMA policy, before any libtorch work
+        med::common::Runtime::configure(cfg);
+
         // Decide on device
         bool useCuda = (cfg.deviceStr == "cuda");
         if (useCuda && !torch::cuda::is_available()) {
@@ -48,43 +122,77 @@ int main(int argc, char** argv) {
         }
         torch::Device device = useCuda ? torch::Device(torch::kCUDA) : torch::Device(torch::kCPU);
 
-        // Create a polymorphic BaseModel shared_ptr
-        std::shared_ptr<med::models::BaseModel> model;
-
-        // Build the actual implementation and upcast
-        switch (cfg.modelType) {
-            case med::common::ModelType::UNet: {
-                auto unetImpl = std::make_shared<med::models::UNetImpl>(1, 1, device);
-                model = unetImpl;  // upcast to shared_ptr<BaseModel>
-                break;
+        // Pick batch size / threads / channels-last for this model and machine
+        if (cfg.autotune && !cfg.skipTraining) {
+            med::trainer::TuneResult tuned;
+            med::trainer::Autotuner tuner(cfg, device);
+            if (tuner.tune(tuned)) {
+                med::trainer::Autotuner::apply(tuned, cfg);
             }
+        }
 
-            case med::common::ModelType::DenseNet: {
-                std::vector<int> blockCfg {6,12,24,16};
-                int growthRate = 32;
-                int numClasses = cfg.clsTrainDir.empty() ? 2 : static_cast<int>(cfg.clsTrainDir.size());
-                auto dnetImpl = std::make_shared<med::models::DenseNetImpl>(blockCfg, growthRate, 64, numClasses, device);
-                model = dnetImpl; // upcast
-                break;
+        // Build the model selected on the command line, or load an exported TorchScript artifact
+        std::shared_ptr<med::models::BaseModel> model;
+        if (!cfg.scriptedPath.empty()) {
+            if (!cfg.modelWeightsPath.empty() || !cfg.pretrainedPath.empty() || cfg.int8 || cfg.quantize) {
+                throw med::error::ConfigException("--scripted", "the artifact holds its own weights; drop --weights, --pretrained, --int8 and quantize");
             }
-
-            case med::common::ModelType::ResNet: {
-                int numClasses = cfg.clsTrainDir.empty() ? 1000 : static_cast<int>(cfg.clsTrainDir.size());
-                // Cast common::ResNetVersion → models::ResNet::Version
-                auto versionImpl = static_cast<med::models::ResNet::Version>(cfg.resnetVersion);
-                auto resImpl = std::make_shared<med::models::ResNet>(versionImpl, numClasses, device);
-                model = resImpl;  // upcast
-                break;
+            auto scripted = std::make_shared<med::models::ScriptedModel>(cfg.scriptedPath, device);
+            // The graph only runs at its traced size (older artifacts: the size export uses)
+            if (cfg.tileSize > 0) {
+                int side = med::models::ModelFactory::inputSize(cfg);
+                std::vector<int64_t> traced = scripted->inputSize();
+                if (traced.empty()) traced = {side, side};
+                if (traced[0] != cfg.tileSize || traced[1] != cfg.tileSize) {
+                    throw med::error::ConfigException("--tile", "the artifact was traced at " + std::to_string(traced[0]) + "x" +
+                        std::to_string(traced[1]) + "; use --tile " + std::to_string(traced[0]) + " or the eager model");
+                }
             }
+            model = scripted;
+        } else {
+            model = med::models::ModelFactory::create(cfg, device);
+        }
 
-            default:
-                throw med::error::ConfigException("main", "Unknown model type");
+        // Start from torchvision weights (transfer learning); --weights still takes precedence
+        if (!cfg.pretrainedPath.empty()) {
+            med::models::WeightImporter::importTorchvision(*model, cfg.modelType, cfg.pretrainedPath);
+        }
+
+        // An int8 checkpoint holds the folded, quantized layout; build that before loading
+        if (cfg.int8 || cfg.quantize) {
+            if (device.type() != torch::kCPU) {
+                throw med::error::ConfigException("int8", "quantized kernels run on the CPU only; drop --cuda");
+            }
+            if (cfg.quantize && (cfg.modelWeightsPath.empty() || !fs::exists(cfg.modelWeightsPath))) {
+                throw med::error::ConfigException("quantize", "needs the trained float model via --weights");
+            }
+        }
+        if (cfg.int8) {
+            model->fuseForInference();
+            model->quantize(/*calibrated=*/false);
         }
 
         // Load weights
         if (!cfg.modelWeightsPath.empty() && fs::exists(cfg.modelWeightsPath)) {
             std::cout << "[INFO] Loading weights from " << cfg.modelWeightsPath << "\n";
+            auto start = std::chrono::steady_clock::now();
             model->loadModel(cfg.modelWeightsPath);
+            std::cout << "[BENCH] Weights loaded in " << std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - start).count() << " ms\n";
+            med::models::ModelFactory::applyMemoryFormat(*model, cfg);
+        }
+
+        // Long-running inference server: the model stays loaded, no trainer or datasets
+        if (cfg.serve) {
+            if (cfg.foldBN) {
+                med::models::ModelFactory::foldBatchNorm(*model, cfg, device);
+            }
+            if (cfg.activationArena && !model->setActivationArena(true)) {
+                std::cerr << "[WARN] --arena is only implemented for UNet; ignoring\n";
+            }
+            med::serving::InferenceServer server(model, cfg, device);
+            server.run();
+            return EXIT_SUCCESS;
         }
 
         // Instantiate Trainer
@@ -95,24 +203,135 @@ int main(int argc, char** argv) {
             trainer = std::make_unique<med::trainer::ClassificationTrainer>(model, cfg);
         }
 
+        std::string outModelName = cfg.modelName.empty()
+            ? (cfg.modelType == med::common::ModelType::UNet 
+            ? "unet" : cfg.modelType == med::common::ModelType::DenseNet 
+            ? "densenet" : "resnet") : cfg.modelName;
+
         // Train (unless skipping) then save
         if (!cfg.skipTraining) {
             std::cout << "[INFO] Starting training...\n";
             trainer->train();
 
-            std::string outModelPath = (cfg.modelName.empty()
-                ? (cfg.modelType == med::common::ModelType::UNet 
-                ? "unet" : cfg.modelType == med::common::ModelType::DenseNet 
-                ? "densenet" : "resnet") : cfg.modelName) + ".pt";
+            std::string outModelPath = outModelName + ".pt";
 
             model->saveModel(outModelPath);
             std::cout << "[INFO] Model saved to " << outModelPath << "\n";
         }
+        if (!cfg.mappedPath.empty()) {
+            med::models::MappedWeights::write(*model, cfg.mappedPath);
+            std::cout << "[INFO] Mapped weights saved to " << cfg.mappedPath << " (load with --weights "
+                      << cfg.mappedPath << ")\n";
+        }
+
+        // Post-training int8: float baseline, calibration, int8 run, comparison, save
+        if (cfg.quantize) {
+            int side = med::models::ModelFactory::inputSize(cfg);
+            std::vector<int64_t> shape = {static_cast<int64_t>(cfg.evalBatchSize),
+                                          med::models::ModelFactory::inputChannels(cfg), side, side};
+            auto format = cfg.channelsLast ? torch::MemoryFormat::ChannelsLast : torch::MemoryFormat::Contiguous;
+            auto timedEvaluate = [&] {
+                auto start = std::chrono::steady_clock::now();
+                trainer->evaluate();
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            };
+
+            std::cout << "[INFO] Float baseline...\n";
+            double floatSeconds = timedEvaluate();
+            double floatScore = trainer->testScore();
+
+            // Quantize the folded convs: BN folding first, so each conv's range is its real output
+            med::models::ModelFactory::foldBatchNorm(*model, cfg, device);
+            auto floatProfile = med::eval::Profiler::profile(*model, shape, device, format);
+            model->setCalibration(true);
+            trainer->calibrate(cfg.calibSamples);
+            model->quantize();
+            auto int8Profile = med::eval::Profiler::profile(*model, shape, device, format);
+
+            std::cout << "[INFO] Int8 model...\n";
+            double int8Seconds = timedEvaluate();
+            double int8Score = trainer->testScore();
+
+            const char* metric = cfg.modelType == med::common::ModelType::UNet ? "Dice" : "accuracy";
+            std::cout << "[BENCH] int8 vs float: " << metric << " " << int8Score << " vs " << floatScore
+                      << " (delta " << (int8Score - floatScore) << "), " << int8Profile.latencyMs << " vs "
+                      << floatProfile.latencyMs << " ms/batch of " << cfg.evalBatchSize << " (x"
+                      << floatProfile.latencyMs / std::max(int8Profile.latencyMs, 1e-9) << "), test set "
+                      << int8Seconds << " vs " << floatSeconds << " s\n";
+
+            std::string int8Path = outModelName + "_int8.pt";
+            model->saveModel(int8Path);
+            std::cout << "[INFO] Int8 model saved to " << int8Path << " (evaluate with --weights "
+                      << int8Path << " --int8 --skip-training)\n";
+            return EXIT_SUCCESS;
+        }
+
+        // Inference-only rewrite, after the weights were saved
+        if (cfg.foldBN) {
+            int side = med::models::ModelFactory::inputSize(cfg);
+            std::vector<int64_t> shape = {static_cast<int64_t>(cfg.evalBatchSize),
+                                          med::models::ModelFactory::inputChannels(cfg), side, side};
+            auto format = cfg.channelsLast ? torch::MemoryFormat::ChannelsLast : torch::MemoryFormat::Contiguous;
+            auto before = med::eval::Profiler::profile(*model, shape, device, format);
+            double diff = med::models::ModelFactory::foldBatchNorm(*model, cfg, device);
+            auto after = med::eval::Profiler::profile(*model, shape, device, format);
+            std::cout << "[BENCH] BatchNorm folding: " << before.latencyMs << " -> " << after.latencyMs
+                      << " ms/batch of " << cfg.evalBatchSize << ", max |output diff| " << diff << "\n";
+            if (diff > 1e-2) {
+                std::cerr << "[WARN] Folded model deviates from the original by " << diff << "\n";
+            }
+        }
+
+        // Planned activation buffers for the inference that follows
+        if (cfg.activationArena) {
+            int side = med::models::ModelFactory::inputSize(cfg);
+            std::vector<int64_t> shape = {static_cast<int64_t>(cfg.evalBatchSize),
+                                          med::models::ModelFactory::inputChannels(cfg), side, side};
+            auto format = cfg.channelsLast ? torch::MemoryFormat::ChannelsLast : torch::MemoryFormat::Contiguous;
+            auto before = med::eval::Profiler::profile(*model, shape, device, format);
+            if (model->setActivationArena(true)) {
+                auto after = med::eval::Profiler::profile(*model, shape, device, format);
+                std::cout << "[BENCH] Activation arena: " << before.allocations << " -> " << after.allocations
+                          << " allocations/forward, peak " << before.peakMB << " -> " << after.peakMB << " MB, "
+                          << before.latencyMs << " -> " << after.latencyMs << " ms/batch of " << cfg.evalBatchSize << "\n";
+            } else {
+                std::cerr << "[WARN] --arena is only implemented for UNet; ignoring\n";
+            }
+        }
 
         // Evaluate
         std::cout << "[INFO] Starting evaluation...\n";
         trainer->evaluate();
 
+        // One comparable line per model variant: cost and quality
+        if (cfg.profileModel) {
+            int side = med::models::ModelFactory::inputSize(cfg);
+            auto profile = med::eval::Profiler::profile(*model,
+                {1, med::models::ModelFactory::inputChannels(cfg), side, side}, device,
+                cfg.channelsLast ? torch::MemoryFormat::ChannelsLast : torch::MemoryFormat::Contiguous);
+            std::cout << "[BENCH] " << med::models::ModelFactory::name(cfg) << " @" << side << "x" << side
+                      << ": " << profile << ", "
+                      << (cfg.modelType == med::common::ModelType::UNet ? "Dice " : "accuracy ")
+                      << trainer->testScore() << "\n";
+        }
+
+        // Standalone deployment artifact: traced, frozen and optimized TorchScript
+        if (!cfg.exportPath.empty()) {
+            int side = med::models::ModelFactory::inputSize(cfg);
+            std::vector<int64_t> shape = {static_cast<int64_t>(cfg.evalBatchSize),
+                                          med::models::ModelFactory::inputChannels(cfg), side, side};
+            auto format = cfg.channelsLast ? torch::MemoryFormat::ChannelsLast : torch::MemoryFormat::Contiguous;
+            auto example = torch::rand(shape, torch::TensorOptions().device(device)).contiguous(format);
+            med::models::ScriptedModel::exportModel(*model, example, cfg.exportPath);
+
+            med::models::ScriptedModel scripted(cfg.exportPath, device);
+            auto eager = med::eval::Profiler::profile(*model, shape, device, format);
+            auto frozen = med::eval::Profiler::profile(scripted, shape, device, format);
+            std::cout << "[BENCH] eager vs frozen TorchScript: " << eager.latencyMs << " vs " << frozen.latencyMs
+                      << " ms/batch of " << cfg.evalBatchSize << " (x"
+                      << eager.latencyMs / std::max(frozen.latencyMs, 1e-9) << ")\n";
+        }
+
         return EXIT_SUCCESS;
     }
     catch (const med::error::Exception& e) {
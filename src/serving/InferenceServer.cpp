@@ -0,0 +1,247 @@
+#include "InferenceServer.hpp"
+#include "Protocol.hpp"
+#include "common/Exception.hpp"
+#include "common/Runtime.hpp"
+#include "models/ModelFactory.hpp"
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <poll.h>
+
+namespace med {
+namespace serving {
+
+namespace {
+
+std::atomic<bool> signalled{false};
+
+void onSignal(int) {
+    signalled = true;
+}
+
+// Wait until `fd` is readable; false on timeout (so callers can check for shutdown)
+bool waitReadable(int fd, int timeoutMs) {
+    pollfd p{fd, POLLIN, 0};
+    return ::poll(&p, 1, timeoutMs) > 0;
+}
+
+} // namespace
+
+InferenceServer::InferenceServer(std::shared_ptr<models::BaseModel> model_, const common::Config& cfg_,
+                                 torch::Device device_)
+: model(std::move(model_)), cfg(cfg_), device(device_),
+  side(models::ModelFactory::inputSize(cfg_)), channels(models::ModelFactory::inputChannels(cfg_)) {}
+
+InferenceServer::~InferenceServer() {
+    stopping = true;
+    queueCv.notify_all();
+    if (batcher.joinable()) batcher.join();
+}
+
+int InferenceServer::listen() const {
+    int fd = -1;
+    if (cfg.servePort > 0) {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(cfg.servePort));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // local clients only
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            if (fd >= 0) ::close(fd);
+            throw error::FileIOException("localhost:" + std::to_string(cfg.servePort), false);
+        }
+    } else {
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, cfg.serveSocket.c_str(), sizeof(addr.sun_path) - 1);
+        ::unlink(cfg.serveSocket.c_str()); // stale socket of a previous run
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            if (fd >= 0) ::close(fd);
+            throw error::FileIOException(cfg.serveSocket, false);
+        }
+    }
+    if (::listen(fd, 64) != 0) {
+        ::close(fd);
+        throw error::FileIOException(cfg.servePort > 0 ? "localhost:" + std::to_string(cfg.servePort) : cfg.serveSocket, false);
+    }
+    return fd;
+}
+
+void InferenceServer::run() {
+    int listenFd = listen();
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    windowStart = Clock::now();
+    batcher = std::thread([this] { batchLoop(); });
+    std::cout << "[INFO] Serving " << models::ModelFactory::name(cfg) << " on "
+              << (cfg.servePort > 0 ? "localhost:" + std::to_string(cfg.servePort) : cfg.serveSocket)
+              << " (batches of up to " << cfg.serveMaxBatch << ", max wait " << cfg.serveMaxWaitMs
+              << " ms); Ctrl-C to stop\n";
+
+    auto lastReport = Clock::now();
+    while (!signalled) {
+        if (waitReadable(listenFd, 200)) {
+            int fd = ::accept(listenFd, nullptr, nullptr);
+            if (fd >= 0) {
+                if (cfg.servePort > 0) {
+                    // Responses go out as header + payload writes: without this, Nagle holds
+                    // the payload until the client's delayed ACK (~40 ms per request)
+                    int one = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                }
+                ++activeConnections;
+                std::thread([this, fd] { serveConnection(fd); }).detach();
+            }
+        }
+        if (Clock::now() - lastReport >= std::chrono::seconds(cfg.serveReportSec)) {
+            report(false);
+            lastReport = Clock::now();
+        }
+    }
+
+    // Connections notice within one poll interval; queued requests are still answered
+    std::cout << "\n[INFO] Shutting down\n";
+    ::close(listenFd);
+    if (cfg.servePort == 0) ::unlink(cfg.serveSocket.c_str());
+    while (activeConnections > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    stopping = true;
+    queueCv.notify_all();
+    batcher.join();
+    report(true);
+}
+
+torch::Tensor InferenceServer::preprocess(const std::vector<uint8_t>& bytes) const {
+    cv::Mat img = cv::imdecode(bytes, cv::IMREAD_COLOR);
+    if (img.empty()) return {};
+    // Same steps as ImageLoader::process
+    cv::Mat resized, gray, scaled;
+    cv::resize(img, resized, cv::Size(side, side));
+    cv::cvtColor(resized, gray, cv::COLOR_BGR2GRAY);
+    gray.convertTo(scaled, CV_32F, 1.0 / 255);
+    auto t = torch::from_blob(scaled.data, {1, side, side}, torch::kFloat).clone();
+    return channels == 1 ? t : t.repeat({channels, 1, 1});
+}
+
+void InferenceServer::serveConnection(int fd) {
+    common::Runtime::pinCurrentThread(common::ThreadRole::IO);
+    std::vector<uint8_t> bytes;
+    while (!signalled) {
+        if (!waitReadable(fd, 200)) continue;
+        RequestHeader req;
+        if (!readAll(fd, &req, sizeof(req))) break;
+        ResponseHeader resp{kResponseMagic, kOk, 0, 0};
+        if (req.magic != kRequestMagic || req.bytes > kMaxRequestBytes) {
+            resp.status = kBadRequest;
+            writeAll(fd, &resp, sizeof(resp));
+            break; // the stream is out of sync
+        }
+        bytes.resize(req.bytes);
+        if (!readAll(fd, bytes.data(), bytes.size())) break;
+
+        torch::Tensor output;
+        auto input = preprocess(bytes);
+        if (!input.defined()) {
+            resp.status = kBadImage;
+        } else {
+            auto request = std::make_shared<Request>();
+            request->input = input;
+            request->arrived = Clock::now();
+            auto result = request->output.get_future();
+            {
+                std::lock_guard<std::mutex> lock(queueMtx);
+                queue.push_back(std::move(request));
+            }
+            queueCv.notify_one();
+            try {
+                output = result.get();
+                resp.count = static_cast<uint32_t>(output.numel());
+            } catch (const std::exception& e) {
+                std::cerr << "[WARN] Inference failed: " << e.what() << "\n";
+                resp.status = kInferenceError;
+            }
+        }
+        if (!writeAll(fd, &resp, sizeof(resp))) break;
+        if (resp.count > 0 && !writeAll(fd, output.data_ptr<float>(), resp.count * sizeof(float))) break;
+    }
+    ::close(fd);
+    --activeConnections;
+}
+
+void InferenceServer::batchLoop() {
+    torch::InferenceMode inferenceMode;
+    model->eval();
+    auto format = cfg.channelsLast ? torch::MemoryFormat::ChannelsLast : torch::MemoryFormat::Contiguous;
+    const auto maxWait = std::chrono::microseconds(static_cast<int64_t>(cfg.serveMaxWaitMs * 1000));
+
+    while (true) {
+        std::vector<std::shared_ptr<Request>> batch;
+        {
+            std::unique_lock<std::mutex> lock(queueMtx);
+            queueCv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return; // stopping, nothing left
+            // Dynamic batching: fill up until the oldest request has waited maxWait
+            auto deadline = queue.front()->arrived + maxWait;
+            queueCv.wait_until(lock, deadline, [this] { return stopping || queue.size() >= cfg.serveMaxBatch; });
+            while (!queue.empty() && batch.size() < cfg.serveMaxBatch) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+
+        try {
+            std::vector<torch::Tensor> inputs;
+            for (const auto& r : batch) inputs.push_back(r->input);
+            auto out = model->predict(torch::stack(inputs).to(device).contiguous(format));
+            out = out.to(torch::kCPU, torch::kFloat).contiguous();
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i]->output.set_value(out[static_cast<int64_t>(i)].contiguous());
+            }
+        } catch (...) {
+            for (auto& r : batch) r->output.set_exception(std::current_exception());
+        }
+
+        auto done = Clock::now();
+        std::lock_guard<std::mutex> lock(statsMtx);
+        for (const auto& r : batch) {
+            latenciesMs.push_back(std::chrono::duration<double, std::milli>(done - r->arrived).count());
+        }
+        ++batches;
+    }
+}
+
+void InferenceServer::report(bool final) {
+    std::vector<double> lat;
+    size_t numBatches;
+    double seconds;
+    {
+        std::lock_guard<std::mutex> lock(statsMtx);
+        lat.swap(latenciesMs);
+        numBatches = batches;
+        batches = 0;
+        auto now = Clock::now();
+        seconds = std::chrono::duration<double>(now - windowStart).count();
+        windowStart = now;
+    }
+    totalRequests += lat.size();
+    if (lat.empty()) {
+        if (final) std::cout << "[SERVE] " << totalRequests << " requests served\n";
+        return;
+    }
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&lat](double q) { return lat[std::min(lat.size() - 1, static_cast<size_t>(q * lat.size()))]; };
+    std::cout << "[SERVE] " << lat.size() << " requests in " << seconds << " s ("
+              << lat.size() / std::max(seconds, 1e-9) << " req/s), mean batch "
+              << static_cast<double>(lat.size()) / std::max<size_t>(numBatches, 1)
+              << ", latency p50 " << pct(0.50) << " ms, p99 " << pct(0.99) << " ms"
+              << (final ? ", " + std::to_string(totalRequests) + " requests in total" : "") << "\n";
+}
+
+} // namespace serving
+} // namespace med
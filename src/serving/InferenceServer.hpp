@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common/ArgParser.hpp"
+#include "models/BaseModel.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <torch/torch.h>
+
+namespace med {
+namespace serving {
+
+// Long-running inference server ("med-cxx serve"): the model is built and loaded once,
+// clients send encoded images over a Unix domain socket (or localhost TCP, see
+// serving/Protocol.hpp). Requests from all connections are coalesced into batches of up
+// to cfg.serveMaxBatch, waiting at most cfg.serveMaxWaitMs after the oldest request.
+// Throughput, batch size and p50/p99 latency are reported every cfg.serveReportSec.
+class InferenceServer {
+public:
+    InferenceServer(std::shared_ptr<models::BaseModel> model, const common::Config& cfg, torch::Device device);
+    ~InferenceServer();
+
+    InferenceServer(const InferenceServer&) = delete;
+    InferenceServer& operator=(const InferenceServer&) = delete;
+
+    // Serve until SIGINT / SIGTERM
+    void run();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        torch::Tensor input;                // [C,H,W] preprocessed image
+        std::promise<torch::Tensor> output; // model output of this image (CPU float)
+        Clock::time_point arrived;
+    };
+
+    // Listening socket on the configured endpoint
+    int listen() const;
+
+    // One client connection (IO thread): read requests, wait for their results, reply
+    void serveConnection(int fd);
+
+    // Batching loop (compute thread)
+    void batchLoop();
+
+    // Decode and preprocess like ImageLoader::process; undefined if the bytes are no image
+    torch::Tensor preprocess(const std::vector<uint8_t>& bytes) const;
+
+    // Print the counters gathered since the last report (and reset them)
+    void report(bool final);
+
+    std::shared_ptr<models::BaseModel> model;
+    const common::Config& cfg;
+    torch::Device device;
+    int side, channels;
+
+    std::deque<std::shared_ptr<Request>> queue;
+    std::mutex queueMtx;
+    std::condition_variable queueCv;
+    std::atomic<bool> stopping{false};
+    std::thread batcher;
+    std::atomic<int> activeConnections{0}; // detached connection threads still running
+
+    // Counters since the last report
+    std::mutex statsMtx;
+    std::vector<double> latenciesMs;
+    size_t batches = 0;
+    Clock::time_point windowStart;
+    size_t totalRequests = 0;
+};
+
+} // namespace serving
+} // namespace med
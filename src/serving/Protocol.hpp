@@ -0,0 +1,99 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace med {
+namespace serving {
+
+// Wire format of "med-cxx serve" (host byte order: both ends run on the same machine).
+// A connection carries any number of request/response pairs, one at a time:
+//   request:  RequestHeader, then `bytes` of an encoded image file (PNG, JPEG, ...)
+//   response: ResponseHeader, then `count` float32 outputs of the model for that image
+//             (class logits, or the H*W mask logits of UNet); count is 0 unless status is kOk
+constexpr uint32_t kRequestMagic = 0x5144454D;  // "MEDQ"
+constexpr uint32_t kResponseMagic = 0x5244454D; // "MEDR"
+constexpr uint32_t kMaxRequestBytes = 64u << 20;
+
+struct RequestHeader {
+    uint32_t magic;
+    uint32_t bytes;
+};
+
+struct ResponseHeader {
+    uint32_t magic;
+    int32_t status;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+enum Status : int32_t { kOk = 0, kBadRequest = 1, kBadImage = 2, kInferenceError = 3 };
+
+// Read exactly n bytes; false on EOF or error
+inline bool readAll(int fd, void* buf, size_t n) {
+    auto* p = static_cast<char*>(buf);
+    while (n > 0) {
+        ssize_t got = ::recv(fd, p, n, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        p += got;
+        n -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+// Write exactly n bytes; false if the peer went away
+inline bool writeAll(int fd, const void* buf, size_t n) {
+    const auto* p = static_cast<const char*>(buf);
+    while (n > 0) {
+        ssize_t sent = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        p += sent;
+        n -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// Connected socket to the server: localhost:port when port > 0, else the Unix socket
+// at `socketPath`; -1 on failure
+inline int connectTo(const std::string& socketPath, int port) {
+    int fd = -1;
+    if (port > 0) {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        int one = 1; // small request/response messages: no Nagle delay
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace serving
+} // namespace med
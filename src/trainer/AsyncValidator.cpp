@@ -0,0 +1,127 @@
+#include "AsyncValidator.hpp"
+#include "common/Runtime.hpp"
+
+namespace med {
+namespace trainer {
+
+AsyncValidator::AsyncValidator(std::shared_ptr<models::BaseModel> replica_, Job job_, std::string bestPath_)
+: replica(std::move(replica_)), job(std::move(job_)), bestPath(std::move(bestPath_)),
+  worker(&AsyncValidator::run, this) {
+    replica->eval();
+}
+
+AsyncValidator::~AsyncValidator() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+bool AsyncValidator::submit(size_t epoch, const models::BaseModel& source) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (running || pendingEpoch != 0) return false;
+    }
+
+    // The worker is idle, so the replica can be overwritten from this thread
+    torch::NoGradGuard noGrad;
+    auto dstParams = replica->named_parameters();
+    auto dstBuffers = replica->named_buffers();
+    for (const auto& item : source.named_parameters()) {
+        if (auto* dst = dstParams.find(item.key())) dst->copy_(item.value());
+    }
+    for (const auto& item : source.named_buffers()) {
+        if (auto* dst = dstBuffers.find(item.key())) dst->copy_(item.value());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        pendingEpoch = epoch;
+    }
+    cv.notify_all();
+    return true;
+}
+
+std::vector<ValidationResult> AsyncValidator::poll() {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<ValidationResult> out;
+    out.swap(finished);
+    return out;
+}
+
+void AsyncValidator::wait() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return !running && pendingEpoch == 0; });
+}
+
+size_t AsyncValidator::passesSinceBest() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return sinceBest;
+}
+
+double AsyncValidator::bestScore() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return best;
+}
+
+size_t AsyncValidator::bestEpoch() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return bestAt;
+}
+
+void AsyncValidator::restore(double bestScore_, size_t bestEpoch_, size_t passesSinceBest_) {
+    std::lock_guard<std::mutex> lock(mtx);
+    best = bestScore_;
+    bestAt = bestEpoch_;
+    sinceBest = passesSinceBest_;
+}
+
+void AsyncValidator::run() {
+    // Off the compute cores: the pass is mostly image loading, and its forward passes run
+    // on the shared intra-op pool anyway, so a Compute pin would only contend with training
+    common::Runtime::pinCurrentThread(common::ThreadRole::Loader);
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        cv.wait(lock, [this] { return pendingEpoch != 0 || stopping; });
+        if (pendingEpoch == 0) break; // stopping with nothing queued
+
+        size_t epoch = pendingEpoch;
+        pendingEpoch = 0;
+        running = true;
+        lock.unlock();
+
+        ValidationResult result;
+        try {
+            torch::NoGradGuard noGrad;
+            result = job(*replica);
+            result.epoch = epoch;
+            if (result.score > bestScore()) {
+                result.improved = true;
+                if (!bestPath.empty()) replica->saveModel(bestPath);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "\n[WARN] Validation for epoch " << epoch << " failed: " << e.what() << "\n";
+            lock.lock();
+            running = false;
+            cv.notify_all();
+            continue;
+        }
+
+        lock.lock();
+        if (result.improved) {
+            best = result.score;
+            bestAt = epoch;
+            sinceBest = 0;
+        } else {
+            ++sinceBest;
+        }
+        finished.push_back(result);
+        running = false;
+        cv.notify_all();
+    }
+}
+
+} // namespace trainer
+} // namespace med
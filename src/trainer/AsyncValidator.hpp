@@ -0,0 +1,81 @@
+#pragma once
+
+#include "models/BaseModel.hpp"
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <torch/torch.h>
+
+namespace med {
+namespace trainer {
+
+// Metrics of one validation pass
+struct ValidationResult {
+    size_t epoch = 0;
+    double loss = 0.0;
+    double score = 0.0;          // higher is better (Dice / accuracy)
+    std::string scoreName;
+    bool improved = false;       // new best score (best weights were saved)
+};
+
+// Runs validation passes on a replica of the model in a background thread, so the
+// training loop only pays for copying the weights into the replica. Keeps track of the
+// best score, saves the best replica weights and counts passes without improvement.
+class AsyncValidator {
+public:
+    // Evaluates the (eval-mode, no-grad) replica on the held-out split
+    using Job = std::function<ValidationResult(models::BaseModel& replica)>;
+
+    AsyncValidator(std::shared_ptr<models::BaseModel> replica, Job job, std::string bestPath);
+
+    // Waits for the running pass and joins the worker
+    ~AsyncValidator();
+
+    AsyncValidator(const AsyncValidator&) = delete;
+    AsyncValidator& operator=(const AsyncValidator&) = delete;
+
+    // Snapshot the weights of `source` and start a pass for `epoch`.
+    // Returns false (and does nothing) while the previous pass is still running.
+    bool submit(size_t epoch, const models::BaseModel& source);
+
+    // Results finished since the last call (non-blocking)
+    std::vector<ValidationResult> poll();
+
+    // Block until the running pass (if any) is finished
+    void wait();
+
+    // Number of finished passes since the last improvement
+    size_t passesSinceBest() const;
+
+    double bestScore() const;
+    size_t bestEpoch() const;
+
+    // Continue from the state of an interrupted run (resume); call while idle
+    void restore(double bestScore, size_t bestEpoch, size_t passesSinceBest);
+
+private:
+    void run();
+
+    std::shared_ptr<models::BaseModel> replica;
+    Job job;
+    std::string bestPath;
+
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    size_t pendingEpoch = 0;     // 0 = nothing queued
+    bool running = false;
+    bool stopping = false;
+    std::vector<ValidationResult> finished;
+    double best = -std::numeric_limits<double>::infinity();
+    size_t bestAt = 0;
+    size_t sinceBest = 0;
+    std::thread worker;
+};
+
+} // namespace trainer
+} // namespace med
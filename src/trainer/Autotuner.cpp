@@ -0,0 +1,345 @@
+#include "Autotuner.hpp"
+#include "common/Exception.hpp"
+#include "common/Loss.hpp"
+#include "common/Runtime.hpp"
+#include "models/ModelFactory.hpp"
+#include "optim/FusedOptimizer.hpp"
+#include <ATen/CPUGeneratorImpl.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#ifdef __linux__
+#include <malloc.h>
+#include <unistd.h>
+#endif
+#ifdef MED_WITH_CUDA
+#include <ATen/cuda/CUDAContext.h>
+#include <ATen/cuda/CUDAGeneratorImpl.h>
+#include <c10/cuda/CUDACachingAllocator.h>
+#include <c10/cuda/CUDAFunctions.h>
+#endif
+
+namespace med {
+namespace trainer {
+
+namespace {
+
+// Value of a "Key:   1234 kB" line of a /proc file, in MB (0 if unavailable)
+size_t readProcMB(const std::string& file, const std::string& key) {
+    std::ifstream in(file);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, key.size() + 1, key + ":") == 0) {
+            std::istringstream value(line.substr(key.size() + 1));
+            size_t kb = 0;
+            value >> kb;
+            return kb / 1024;
+        }
+    }
+    return 0;
+}
+
+// Peak resident set size since the last resetPeakRSS()
+size_t peakRSSMB() {
+    return readProcMB("/proc/self/status", "VmHWM");
+}
+
+void resetPeakRSS() {
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs) clearRefs << "5"; // resets VmHWM to the current RSS
+}
+
+#ifdef MED_WITH_CUDA
+c10::DeviceIndex cudaIndex(const torch::Device& device) {
+    return device.has_index() ? device.index() : c10::cuda::current_device();
+}
+#endif
+
+// Peak memory of `device` since the last resetPeakMemory(): the caching allocator's
+// reserved bytes on CUDA, the resident set size otherwise
+size_t peakMemoryMB(const torch::Device& device) {
+#ifdef MED_WITH_CUDA
+    if (device.is_cuda()) {
+        auto stats = c10::cuda::CUDACachingAllocator::getDeviceStats(cudaIndex(device));
+        auto aggregate = static_cast<size_t>(c10::CachingDeviceAllocator::StatType::AGGREGATE);
+        return static_cast<size_t>(stats.reserved_bytes[aggregate].peak) >> 20;
+    }
+#endif
+    return peakRSSMB();
+}
+
+// Returns the memory still in use right after the reset, which the next candidate did
+// not allocate (0 on CUDA, where the previous candidate's blocks are all released)
+size_t resetPeakMemory(const torch::Device& device) {
+#ifdef MED_WITH_CUDA
+    if (device.is_cuda()) {
+        // Release the previous candidate's cached blocks so they do not count against this one
+        c10::cuda::CUDACachingAllocator::emptyCache();
+        c10::cuda::CUDACachingAllocator::resetPeakStats(cudaIndex(device));
+        return 0;
+    }
+#endif
+#ifdef __GLIBC__
+    malloc_trim(0); // hand heap freed by earlier candidates back to the system
+#endif
+    resetPeakRSS();
+    return readProcMB("/proc/self/status", "VmRSS");
+}
+
+// Saves the default generators probing draws from (the CPU's, and the GPU's when probing
+// there) and restores them on destruction, so the real run starts from the same stream
+class RngStateGuard {
+public:
+    explicit RngStateGuard([[maybe_unused]] const torch::Device& device) {
+        gens.push_back(at::detail::getDefaultCPUGenerator());
+#ifdef MED_WITH_CUDA
+        if (device.is_cuda()) gens.push_back(at::cuda::detail::getDefaultCUDAGenerator(cudaIndex(device)));
+#endif
+        for (auto& gen : gens) {
+            std::lock_guard<std::mutex> lock(gen.mutex());
+            states.push_back(gen.get_state());
+        }
+    }
+
+    ~RngStateGuard() {
+        for (size_t i = 0; i < gens.size(); ++i) {
+            std::lock_guard<std::mutex> lock(gens[i].mutex());
+            gens[i].set_state(states[i]);
+        }
+    }
+
+    RngStateGuard(const RngStateGuard&) = delete;
+    RngStateGuard& operator=(const RngStateGuard&) = delete;
+
+private:
+    std::vector<at::Generator> gens;
+    std::vector<torch::Tensor> states;
+};
+
+std::string hostName() {
+#ifdef __linux__
+    char buf[256] = {};
+    if (gethostname(buf, sizeof(buf) - 1) == 0) return buf;
+#endif
+    return "localhost";
+}
+
+} // namespace
+
+Autotuner::Autotuner(const common::Config& cfg_, torch::Device device_)
+: cfg(cfg_), device(device_) {
+    // Same input shapes as SegmentationTrainer / ClassificationTrainer (full resolution)
+    channels = models::ModelFactory::inputChannels(cfg);
+    height = width = models::ModelFactory::inputSize(cfg);
+
+    budgetMB = cfg.autotuneMemoryMB;
+#ifdef MED_WITH_CUDA
+    if (budgetMB == 0 && device.is_cuda()) {
+        // Default on the GPU: 90% of the device memory
+        budgetMB = (at::cuda::getDeviceProperties(cudaIndex(device))->totalGlobalMem >> 20) * 9 / 10;
+    }
+#endif
+    startMB = device.is_cuda() ? 0 : readProcMB("/proc/self/status", "VmRSS");
+    if (budgetMB == 0 && !device.is_cuda()) {
+        // Default: what is resident now plus 80% of the memory still available
+        size_t available = readProcMB("/proc/meminfo", "MemAvailable");
+        if (available > 0) {
+            budgetMB = startMB + available * 8 / 10;
+        }
+    }
+}
+
+std::string Autotuner::cacheKey() const {
+    std::ostringstream key;
+    key << models::ModelFactory::name(cfg) << "/" << channels << "x" << height << "x" << width
+        << "/" << device.str() << "/" << hostName();
+    return key.str();
+}
+
+bool Autotuner::lookup(TuneResult& result) const {
+    std::ifstream in(cfg.autotuneCache);
+    std::string line, key = cacheKey();
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string lineKey;
+        TuneResult r;
+        if (fields >> lineKey >> r.batchSize >> r.threads >> r.channelsLast >> r.samplesPerSec && lineKey == key) {
+            result = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Autotuner::store(const TuneResult& result) const {
+    // Rewrite the cache, replacing this key's entry
+    std::vector<std::string> lines;
+    std::string line, key = cacheKey();
+    {
+        std::ifstream in(cfg.autotuneCache);
+        while (std::getline(in, line)) {
+            if (line.compare(0, key.size() + 1, key + " ") != 0) lines.push_back(line);
+        }
+    }
+    std::ostringstream entry;
+    entry << key << " " << result.batchSize << " " << result.threads << " "
+          << result.channelsLast << " " << result.samplesPerSec;
+    lines.push_back(entry.str());
+
+    std::ofstream out(cfg.autotuneCache, std::ios::trunc);
+    if (!out) {
+        throw error::FileIOException(cfg.autotuneCache, false);
+    }
+    for (const auto& l : lines) out << l << "\n";
+}
+
+std::vector<int> Autotuner::threadCandidates() const {
+    // The intra-op pool hardly matters when the GPU does the work
+    if (device.is_cuda()) return {at::get_num_threads()};
+
+    int maxThreads = static_cast<int>(common::Runtime::computeCoreCount());
+    if (maxThreads == 0) maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<int> candidates;
+    for (int t : {maxThreads / 4, maxThreads / 2, maxThreads}) {
+        if (t >= 1 && std::find(candidates.begin(), candidates.end(), t) == candidates.end()) {
+            candidates.push_back(t);
+        }
+    }
+    return candidates;
+}
+
+bool Autotuner::probe(size_t batchSize, int threads, bool channelsLast, TuneResult& result) const {
+    common::Config probeCfg = cfg;
+    probeCfg.batchSize = batchSize;
+    probeCfg.channelsLast = channelsLast;
+    common::Runtime::setIntraOpThreads(threads);
+    const size_t baselineMB = resetPeakMemory(device);
+
+    try {
+        auto model = models::ModelFactory::create(probeCfg, device);
+        model->train();
+        optim::FusedOptimizer optimizer(model->parameters(), optim::optionsFromConfig(probeCfg));
+
+        const int64_t B = static_cast<int64_t>(batchSize);
+        auto format = channelsLast ? torch::MemoryFormat::ChannelsLast : torch::MemoryFormat::Contiguous;
+        auto input = torch::rand({B, channels, height, width}, torch::TensorOptions().device(device)).contiguous(format);
+        torch::Tensor target;
+
+        auto step = [&] {
+            optimizer.zero_grad();
+            auto output = model->predict(input);
+            torch::Tensor loss;
+            if (cfg.modelType == common::ModelType::UNet) {
+                if (!target.defined()) target = (torch::rand_like(output) > 0.5).to(output.dtype());
+                loss = med::loss::bceDiceLoss(output, target, cfg.bcePosWeight);
+            } else {
+                if (!target.defined()) target = torch::randint(0, output.size(1), {B}, torch::TensorOptions().dtype(torch::kLong).device(device));
+                loss = torch::nn::functional::cross_entropy(output, target);
+            }
+            loss.backward();
+            optimizer.step();
+            return loss;
+        };
+
+        step().item<double>(); // warm-up (allocations, kernel selection)
+        auto start = std::chrono::steady_clock::now();
+        torch::Tensor loss;
+        for (size_t i = 0; i < cfg.autotuneSteps; ++i) loss = step();
+        loss.item<double>(); // wait for queued device work
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Only what this candidate added counts, on top of what was resident before tuning
+        size_t peak = startMB + std::max(peakMemoryMB(device), baselineMB) - baselineMB;
+        if (budgetMB > 0 && peak > budgetMB) {
+            std::cout << "  batch " << batchSize << ": peak " << peak << " MB exceeds the "
+                      << budgetMB << " MB budget\n";
+            return false;
+        }
+
+        result.batchSize = batchSize;
+        result.threads = threads;
+        result.channelsLast = channelsLast;
+        result.samplesPerSec = static_cast<double>(batchSize * cfg.autotuneSteps) / seconds;
+        std::cout << "  batch " << batchSize << ", threads " << threads
+                  << ", channels-last " << (channelsLast ? "on" : "off") << ": "
+                  << result.samplesPerSec << " samples/s, peak " << peak << " MB\n";
+        return true;
+    } catch (const c10::Error& e) {
+        // Typically out of memory on the device
+        std::cout << "  batch " << batchSize << ": failed (" << e.what_without_backtrace() << ")\n";
+        return false;
+    }
+}
+
+bool Autotuner::tune(TuneResult& best) {
+    if (lookup(best)) {
+        std::cout << "[INFO] Autotune: using cached result for " << cacheKey() << "\n";
+        return true;
+    }
+
+    std::cout << "[INFO] Autotune: probing " << cacheKey()
+              << " (memory budget " << budgetMB << " MB)\n";
+
+    const int initialThreads = at::get_num_threads();
+
+    best = TuneResult();
+    {
+        // Probing must not change the random stream the real run starts from
+        RngStateGuard rngState(device);
+        for (bool channelsLast : {false, true}) {
+            for (int threads : threadCandidates()) {
+                // Grow the batch while it still pays off and fits
+                double previous = 0.0;
+                for (size_t b = 1; b <= cfg.autotuneMaxBatch; b *= 2) {
+                    TuneResult r;
+                    if (!probe(b, threads, channelsLast, r)) break;
+                    if (r.samplesPerSec > best.samplesPerSec) best = r;
+                    if (r.samplesPerSec < previous * 1.02) break;
+                    previous = r.samplesPerSec;
+                }
+            }
+        }
+    }
+    common::Runtime::setIntraOpThreads(initialThreads);
+
+    if (best.samplesPerSec <= 0.0) {
+        std::cerr << "[WARN] Autotune: no configuration fit in the memory budget; keeping the command-line settings\n";
+        return false;
+    }
+    store(best);
+    return true;
+}
+
+void Autotuner::apply(const TuneResult& result, common::Config& cfg) {
+    // A global batch (batch size x accumulation steps) chosen on the command line is kept,
+    // so the learning rate stays valid: the tuned size only splits it into micro-batches.
+    // With the defaults (global batch 1) the tuned batch becomes the global batch.
+    const size_t global = cfg.batchSize * cfg.accumulateSteps;
+    if (global > 1) {
+        cfg.accumulateSteps = (global + result.batchSize - 1) / result.batchSize;
+        cfg.batchSize = global / cfg.accumulateSteps;
+        if (cfg.batchSize * cfg.accumulateSteps != global) {
+            std::cerr << "[WARN] Autotune: global batch " << global << " is not a multiple of the micro-batch; using "
+                      << cfg.batchSize * cfg.accumulateSteps << "\n";
+        }
+    } else {
+        cfg.batchSize = result.batchSize;
+        if (result.batchSize > 1) {
+            std::cerr << "[WARN] Autotune: effective batch size is now " << result.batchSize
+                      << "; --lr is not rescaled (set --batch-size/--accumulate-steps to fix the global batch)\n";
+        }
+    }
+    cfg.intraOpThreads = result.threads;
+    cfg.channelsLast = result.channelsLast;
+    common::Runtime::setIntraOpThreads(result.threads);
+    std::cout << "[INFO] Autotune: batch " << cfg.batchSize << " x " << cfg.accumulateSteps
+              << " accumulation steps, threads " << result.threads
+              << ", channels-last " << (result.channelsLast ? "on" : "off")
+              << " (" << result.samplesPerSec << " samples/s)\n";
+}
+
+} // namespace trainer
+} // namespace med
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common/ArgParser.hpp"
+#include <string>
+#include <vector>
+#include <torch/torch.h>
+
+namespace med {
+namespace trainer {
+
+// One measured (or cached) training configuration
+struct TuneResult {
+    size_t batchSize = 1;
+    int threads = 1;
+    bool channelsLast = false;
+    double samplesPerSec = 0.0;
+};
+
+// Startup autotuner: times a few synthetic training steps of the configured model for
+// candidate batch sizes, intra-op thread counts and channels-last on/off, skipping
+// configurations that exceed the memory budget (host RSS, or the CUDA caching allocator's
+// peak reservation on the GPU), and keeps the best samples/sec.
+// Results are cached in cfg.autotuneCache per (model, input size, device, host).
+class Autotuner {
+public:
+    Autotuner(const common::Config& cfg, torch::Device device);
+
+    // Cached result for this model/input/host, or a fresh probe (which is then cached).
+    // Returns false if no candidate fit in the memory budget.
+    bool tune(TuneResult& best);
+
+    // Write a result into cfg and resize the intra-op pool accordingly. A global batch
+    // above 1 (batchSize x accumulateSteps) is kept by re-splitting it into micro-batches.
+    static void apply(const TuneResult& result, common::Config& cfg);
+
+private:
+    std::string cacheKey() const;
+    bool lookup(TuneResult& result) const;
+    void store(const TuneResult& result) const;
+
+    // Thread counts worth trying on this machine
+    std::vector<int> threadCandidates() const;
+
+    // Time cfg.autotuneSteps steps; false when over budget or out of memory
+    bool probe(size_t batchSize, int threads, bool channelsLast, TuneResult& result) const;
+
+    const common::Config& cfg;
+    torch::Device device;
+    int64_t channels, height, width; // synthetic input shape (as fed by the trainers)
+    size_t budgetMB;                 // peak memory allowed: resident set, or device memory on CUDA (0 = unchecked)
+    size_t startMB;                  // resident set before probing (host); candidates are counted on top of it
+};
+
+} // namespace trainer
+} // namespace med
@@ -1,4 +1,10 @@
 #include "BaseTrainer.hpp"
+#include "common/Loss.hpp"
+#include "models/ModelFactory.hpp"
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <unordered_map>
 
 namespace med {
 namespace trainer {
@@ -10,15 +16,426 @@ BaseTrainer::BaseTrainer(std::shared_ptr<models::BaseModel> model, const common:
     if (cfg_.useCUDA && !torch::cuda::is_available()) {
         std::cout << "[INFO] CUDA requested but not available. Falling back to CPU.\n";
     }
+    if (cfg_.loaderWorkers > 0) {
+        loaderPool = std::make_unique<common::WorkerPool>(cfg_.loaderWorkers, [] {
+            common::Runtime::pinCurrentThread(common::ThreadRole::Loader);
+        });
+    }
+}
+
+
+optim::FusedOptimizer BaseTrainer::makeOptimizer() {
+    return optim::FusedOptimizer(model->parameters(), optim::optionsFromConfig(cfg));
+}
+
+cv::Size BaseTrainer::fullSize() const {
+    int side = models::ModelFactory::inputSize(cfg);
+    return cv::Size(side, side);
+}
+
+cv::Size BaseTrainer::epochSize(size_t epoch) const {
+    if (cfg.resizeSchedule.empty()) return fullSize();
+    size_t stages = cfg.resizeSchedule.size();
+    size_t stage = std::min(stages - 1, (epoch - 1) * stages / std::max<size_t>(1, cfg.epochs));
+    int side = cfg.resizeSchedule[stage];
+    return cv::Size(side, side);
+}
+
+std::vector<cv::Size> BaseTrainer::scheduleSizes() const {
+    std::vector<cv::Size> sizes;
+    for (int side : cfg.resizeSchedule) {
+        sizes.emplace_back(side, side);
+    }
+    return sizes;
+}
+
+torch::Tensor BaseTrainer::toInput(const torch::Tensor& batch) const {
+    auto format = cfg.channelsLast ? torch::MemoryFormat::ChannelsLast : torch::MemoryFormat::Contiguous;
+    return batch.to(device).contiguous(format);
+}
+
+bool BaseTrainer::stepAccumulated(optim::FusedOptimizer& optimizer, size_t& windowSamples) {
+    const size_t used = windowSamples;
+    windowSamples = 0;
+    if (used == 0) {
+        optimizer.zero_grad();
+        return false;
+    }
+    optimizer.scaleGradients(1.0 / static_cast<double>(used));
+    optimizer.step();
+    optimizer.zero_grad();
+    return true;
+}
+
+bool BaseTrainer::isStepBoundary(size_t batchIdx, size_t numBatches) const {
+    return (batchIdx + 1) % cfg.accumulateSteps == 0 || batchIdx + 1 == numBatches;
+}
+
+TrainingCursor BaseTrainer::beginTraining(optim::FusedOptimizer& optimizer, size_t numSamples) {
+    TrainingCursor cursor;
+    cursor.batchSize = cfg.batchSize;
+    cursor.accumulateSteps = cfg.accumulateSteps;
+    if (cfg.importanceSampling) {
+        cursor.sampleLoss = torch::full({static_cast<int64_t>(numSamples)}, -1.0,
+                                        torch::TensorOptions().dtype(torch::kFloat).device(device));
+    }
+    drawEpoch(cursor, numSamples);
+
+    if (!cfg.resumePath.empty()) {
+        TrainingState state = Checkpoint::read(cfg.resumePath);
+        bool sameData = state.cursor.sampleLoss.defined()
+            ? state.cursor.sampleLoss.numel() == static_cast<int64_t>(numSamples)
+            : state.cursor.dataOrder.size() == numSamples;
+        if (!sameData) {
+            throw error::ConfigException("resume", "checkpoint was taken on a dataset of a different size");
+        }
+        // Another geometry would replay different micro-batches and step boundaries
+        if (state.cursor.batchSize != 0 &&
+            (state.cursor.batchSize != cfg.batchSize || state.cursor.accumulateSteps != cfg.accumulateSteps)) {
+            throw error::ConfigException("resume", "checkpoint was taken with --batch-size " +
+                std::to_string(state.cursor.batchSize) + " --accumulate-steps " +
+                std::to_string(state.cursor.accumulateSteps) + "; use the same values");
+        }
+        Checkpoint::restore(state, *model, optimizer);
+        torch::Tensor freshLoss = cursor.sampleLoss;
+        cursor = state.cursor;
+        cursor.sampleLoss = cursor.sampleLoss.defined() ? cursor.sampleLoss.to(device) : freshLoss;
+        cursor.batchSize = cfg.batchSize;
+        cursor.accumulateSteps = cfg.accumulateSteps;
+        if (activeValidator) {
+            activeValidator->restore(cursor.bestScore, cursor.bestEpoch, cursor.passesSinceBest);
+        }
+        std::cout << "[INFO] Resumed from " << cfg.resumePath << " at epoch " << cursor.epoch
+                  << ", step " << cursor.globalStep << "\n";
+    }
+
+    if (cfg.checkpointEvery > 0) {
+        std::string path = cfg.checkpointPath.empty()
+            ? (cfg.modelName.empty() ? "checkpoint" : cfg.modelName) + "_ckpt.pt"
+            : cfg.checkpointPath;
+        checkpointWriter = std::make_unique<AsyncCheckpointWriter>(path);
+    }
+
+    trainStart = std::chrono::steady_clock::now();
+    validatedAt.clear();
+    targetReached = false;
+
+    deviceLossSum = torch::zeros({}, torch::TensorOptions().dtype(torch::kDouble).device(device));
+    pendingLosses = 0;
+    reporter = std::make_unique<util::ProgressReporter>(
+        cfg.printBarWidth, std::chrono::milliseconds(cfg.progressIntervalMs));
+    size_t totalBatches = (cursor.dataOrder.size() + cfg.batchSize - 1) / cfg.batchSize;
+    reporter->startEpoch(cursor.epoch, cfg.epochs, totalBatches, cursor.batchIdx);
+    if (cursor.lossCount > 0) {
+        reporter->setLoss(cursor.epochLoss / cursor.lossCount);
+    }
+    return cursor;
 }
 
+void BaseTrainer::advanceEpoch(TrainingCursor& cursor, size_t numSamples) {
+    ++cursor.epoch;
+    cursor.batchIdx = 0;
+    cursor.epochLoss = 0.0;
+    cursor.lossCount = 0;
+    if (cursor.epoch <= cfg.epochs) {
+        drawEpoch(cursor, numSamples);
+        reporter->startEpoch(cursor.epoch, cfg.epochs, (cursor.dataOrder.size() + cfg.batchSize - 1) / cfg.batchSize);
+        reporter->setLoss(0.0);
+    }
+}
 
-torch::optim::Adam BaseTrainer::makeOptimizer() {
-    return torch::optim::Adam(model->parameters(), torch::optim::AdamOptions(cfg.learningRate));
+void BaseTrainer::recordStep(const torch::Tensor& loss, TrainingCursor& cursor, size_t totalBatches) {
+    if (loss.defined()) {
+        deviceLossSum.add_(loss.detach());
+        ++pendingLosses;
+        ++cursor.lossCount;
+        if (cursor.lossCount % cfg.logEvery == 0) {
+            syncLoss(cursor);
+        }
+    }
+    reporter->update(std::min(cursor.batchIdx + 1, totalBatches));
+}
+
+void BaseTrainer::syncLoss(TrainingCursor& cursor) {
+    if (pendingLosses == 0) return;
+    cursor.epochLoss += deviceLossSum.item<double>();
+    deviceLossSum.zero_();
+    pendingLosses = 0;
+    reporter->setLoss(cursor.epochLoss / std::max<size_t>(1, cursor.lossCount));
+}
+
+void BaseTrainer::finishEpoch(TrainingCursor& cursor) {
+    syncLoss(cursor);
+    reporter->finishEpoch(cursor.epochLoss / std::max<size_t>(1, cursor.lossCount));
+}
+
+void BaseTrainer::afterOptimizerStep(const optim::FusedOptimizer& optimizer, TrainingCursor& cursor) {
+    ++cursor.globalStep;
+    if (!checkpointWriter || cursor.globalStep % cfg.checkpointEvery != 0) {
+        return;
+    }
+    // The snapshot resumes after the micro-batch that closed this window
+    syncLoss(cursor);
+    TrainingCursor next = cursor;
+    ++next.batchIdx;
+    if (activeValidator) {
+        // A pass still running would be lost on resume; its result is reported at epoch end
+        activeValidator->wait();
+        next.bestScore = activeValidator->bestScore();
+        next.bestEpoch = activeValidator->bestEpoch();
+        next.passesSinceBest = activeValidator->passesSinceBest();
+    }
+    checkpointWriter->submit(Checkpoint::capture(*model, optimizer, next));
+}
+
+void BaseTrainer::endTraining() {
+    reporter.reset();
+    activeValidator = nullptr;
+    if (checkpointWriter) {
+        checkpointWriter->flush();
+        checkpointWriter.reset();
+    }
 }
 
-void BaseTrainer::printProgress(size_t current, size_t total) {
-    med::util::printProgressBar(current, total, cfg.printBarWidth);
+std::shared_ptr<models::BaseModel> BaseTrainer::loadTeacher() const {
+    common::Config teacherCfg = cfg;
+    teacherCfg.resnetVersion = cfg.teacherResNetVersion;
+    teacherCfg.unetWidth = cfg.teacherUnetWidth;
+    teacherCfg.unetDepth = cfg.teacherUnetDepth;
+    teacherCfg.unetSeparable = false;
+    teacherCfg.unetBilinear = false;
+
+    auto teacher = models::ModelFactory::create(teacherCfg, device);
+    teacher->loadModel(cfg.teacherPath);
+    models::ModelFactory::applyMemoryFormat(*teacher, teacherCfg);
+    teacher->eval();
+    for (auto& p : teacher->parameters()) p.set_requires_grad(false);
+    std::cout << "[INFO] Teacher: " << models::ModelFactory::name(teacherCfg) << " from " << cfg.teacherPath << "\n";
+    return teacher;
+}
+
+void BaseTrainer::cacheTeacherOutputs(size_t numSamples, const std::function<torch::Tensor(size_t)>& loadSample) {
+    if (cfg.teacherPath.empty()) return;
+    auto teacher = loadTeacher();
+
+    // Queue the samples of one batch on the loader workers; an unreadable one comes back undefined
+    auto fetch = [&](size_t first) {
+        std::vector<std::future<torch::Tensor>> pending;
+        size_t last = std::min(numSamples, first + cfg.batchSize);
+        for (size_t i = first; i < last; ++i) {
+            pending.push_back(loadAsync([&loadSample, i]() -> torch::Tensor {
+                try {
+                    return loadSample(i);
+                } catch (const std::exception& e) {
+                    std::cerr << "[WARN] No teacher output for sample " << i << ": " << e.what() << "\n";
+                    return torch::Tensor();
+                }
+            }));
+        }
+        return pending;
+    };
+
+    // The inputs never change between epochs, so one teacher pass serves the whole run
+    std::cout << "[INFO] Caching teacher outputs for " << numSamples << " samples\n";
+    torch::NoGradGuard noGrad;
+    std::vector<torch::Tensor> outputs, rows;
+    auto next = fetch(0);
+    for (size_t first = 0; first < numSamples; first += cfg.batchSize) {
+        // The next batch loads while the teacher runs on this one
+        auto batch = std::move(next);
+        if (first + cfg.batchSize < numSamples) next = fetch(first + cfg.batchSize);
+        std::vector<torch::Tensor> imgs;
+        std::vector<int64_t> ids;
+        for (size_t k = 0; k < batch.size(); ++k) {
+            auto img = batch[k].get();
+            if (!img.defined()) continue;
+            imgs.push_back(img);
+            ids.push_back(static_cast<int64_t>(first + k));
+        }
+        if (!imgs.empty()) {
+            auto out = teacher->predict(toInput(torch::stack(imgs)));
+            // Soft targets need no more than half precision; maps are large, logits are not
+            outputs.push_back(out.to(torch::kCPU, out.dim() > 2 ? torch::kHalf : torch::kFloat));
+            rows.push_back(torch::tensor(ids, torch::kLong));
+        }
+        util::printProgressBar(std::min(numSamples, first + cfg.batchSize), numSamples, cfg.printBarWidth);
+    }
+    std::cout << "\n";
+    if (outputs.empty()) {
+        throw error::DataProcessingException("distillation", "the teacher could not read any training sample");
+    }
+
+    // Rows of unreadable samples stay NaN
+    auto all = torch::cat(outputs);
+    auto shape = all.sizes().vec();
+    shape[0] = static_cast<int64_t>(numSamples);
+    teacherOutputs = torch::full(shape, std::numeric_limits<float>::quiet_NaN(), all.options());
+    teacherOutputs.index_copy_(0, torch::cat(rows), all);
+}
+
+torch::Tensor BaseTrainer::distill(const torch::Tensor& gtPerSample, const torch::Tensor& output,
+                                   const TrainingCursor& cursor, const std::vector<size_t>& positions) const {
+    if (!teacherOutputs.defined()) return gtPerSample;
+    std::vector<int64_t> ids;
+    ids.reserve(positions.size());
+    for (size_t p : positions) ids.push_back(cursor.dataOrder[p]);
+    auto teacher = teacherOutputs.index_select(0, torch::tensor(ids, torch::kLong)).to(device, torch::kFloat);
+    // NaN rows: the teacher never saw that sample
+    auto seen = teacher.flatten(1).isnan().any(1).logical_not();
+    teacher = teacher.nan_to_num(0.0);
+
+    // Progressive resizing trains below the resolution the maps were cached at
+    if (teacher.dim() == 4 && (teacher.size(2) != output.size(2) || teacher.size(3) != output.size(3))) {
+        teacher = torch::nn::functional::interpolate(teacher,
+            torch::nn::functional::InterpolateFuncOptions()
+                .size(std::vector<int64_t>{output.size(2), output.size(3)})
+                .mode(torch::kBilinear)
+                .align_corners(false));
+    }
+    auto soft = loss::distillationLossPerSample(output, teacher, cfg.distillTemperature);
+    return torch::where(seen, gtPerSample * (1.0 - cfg.distillAlpha) + soft * cfg.distillAlpha, gtPerSample);
+}
+
+void BaseTrainer::runCalibration(size_t numAvailable, size_t numSamples,
+                                 const std::function<torch::Tensor(size_t)>& loadImage) {
+    numSamples = std::min(numSamples, numAvailable);
+    if (numSamples == 0) {
+        throw error::DataProcessingException("calibration", "no training images to calibrate on");
+    }
+    std::cout << "[INFO] Calibrating on " << numSamples << " training images\n";
+    model->eval();
+    torch::InferenceMode inferenceMode;
+    for (size_t first = 0; first < numSamples; first += cfg.evalBatchSize) {
+        size_t last = std::min(numSamples, first + cfg.evalBatchSize);
+        std::vector<std::future<torch::Tensor>> pending;
+        for (size_t k = first; k < last; ++k) {
+            size_t i = k * numAvailable / numSamples;
+            pending.push_back(loadAsync([&loadImage, i] { return loadImage(i); }));
+        }
+        std::vector<torch::Tensor> imgs;
+        for (auto& img : pending) {
+            auto imgT = img.get();
+            if (imgT.defined()) imgs.push_back(imgT);
+        }
+        if (!imgs.empty()) model->predict(toInput(torch::stack(imgs)));
+        util::printProgressBar(last, numSamples, cfg.printBarWidth);
+    }
+    std::cout << "\n";
+}
+
+std::unique_ptr<AsyncValidator> BaseTrainer::makeValidator(AsyncValidator::Job job) {
+    auto replica = models::ModelFactory::create(cfg, device);
+    std::string bestPath = (cfg.modelName.empty() ? "model" : cfg.modelName) + "_best.pt";
+    auto validator = std::make_unique<AsyncValidator>(std::move(replica), std::move(job), bestPath);
+    activeValidator = validator.get();
+    return validator;
+}
+
+bool BaseTrainer::validateEpoch(AsyncValidator& validator, const TrainingCursor& cursor) {
+    if (cursor.epoch % cfg.valEvery == 0 || cursor.epoch == cfg.epochs) {
+        if (validator.submit(cursor.epoch, *model)) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - trainStart).count();
+            validatedAt[cursor.epoch] = {elapsed, cursor.globalStep};
+        } else {
+            std::cout << "[VAL] Epoch " << cursor.epoch << ": previous pass still running, skipped\n";
+        }
+    }
+    reportValidation(validator.poll(), validator);
+
+    if (cfg.earlyStopPatience > 0 && validator.passesSinceBest() >= cfg.earlyStopPatience) {
+        std::cout << "[INFO] Early stopping: no improvement in " << cfg.earlyStopPatience
+                  << " validation passes (best at epoch " << validator.bestEpoch() << ")\n";
+        return true;
+    }
+    return false;
+}
+
+void BaseTrainer::finishValidation(AsyncValidator& validator) {
+    validator.wait();
+    reportValidation(validator.poll(), validator);
+}
+
+void BaseTrainer::reportValidation(const std::vector<ValidationResult>& results, const AsyncValidator& validator) {
+    for (const auto& r : results) {
+        std::cout << "[VAL] Epoch " << r.epoch << ": loss=" << r.loss << ", " << r.scoreName << "=" << r.score
+                  << (r.improved ? " (new best, saved)" : "")
+                  << " | best " << validator.bestScore() << " @ epoch " << validator.bestEpoch() << "\n";
+
+        // Time counts up to the moment the validated weights were taken, not the end of the pass
+        if (cfg.targetScore > 0.0 && !targetReached && r.score >= cfg.targetScore) {
+            targetReached = true;
+            auto at = validatedAt[r.epoch];
+            std::cout << "[VAL] Reached " << r.scoreName << " >= " << cfg.targetScore
+                      << " at epoch " << r.epoch << " after " << std::fixed << std::setprecision(1)
+                      << at.first << std::defaultfloat << " s (" << at.second << " optimizer steps)\n";
+        }
+    }
+}
+
+void BaseTrainer::drawEpoch(TrainingCursor& cursor, size_t numSamples) const {
+    cursor.sampleWeights.clear();
+    if (!cfg.importanceSampling || cursor.epoch <= cfg.isWarmupEpochs || numSamples == 0) {
+        cursor.dataOrder.resize(numSamples);
+        std::iota(cursor.dataOrder.begin(), cursor.dataOrder.end(), 0);
+        return;
+    }
+
+    // p_i proportional to the running loss, mixed with uniform so no sample starves;
+    // samples never seen count as the hardest ones
+    const double N = static_cast<double>(numSamples);
+    auto losses = cursor.sampleLoss.to(torch::kCPU, torch::kDouble);
+    auto seen = losses >= 0;
+    double hardest = seen.any().item<bool>() ? losses.masked_select(seen).max().item<double>() : 1.0;
+    losses = torch::where(seen, losses, torch::full_like(losses, hardest)).clamp_min(1e-12);
+    auto probs = (1.0 - cfg.isUniformMix) * losses / losses.sum() + cfg.isUniformMix / N;
+
+    // Draw with replacement (CPU generator, so the draw is covered by checkpoints);
+    // weights 1/(N p) keep the weighted mean an unbiased estimate of the full-data loss
+    int64_t draws = std::max<int64_t>(1, std::llround(cfg.isFraction * N));
+    auto idx = torch::multinomial(probs, draws, /*replacement=*/true);
+    auto weights = (1.0 / (N * probs.index_select(0, idx))).contiguous();
+    cursor.dataOrder.assign(idx.data_ptr<int64_t>(), idx.data_ptr<int64_t>() + draws);
+    cursor.sampleWeights.assign(weights.data_ptr<double>(), weights.data_ptr<double>() + draws);
+}
+
+torch::Tensor BaseTrainer::sampledMean(const torch::Tensor& perSample, const TrainingCursor& cursor,
+                                       const std::vector<size_t>& positions) const {
+    if (cursor.sampleWeights.empty()) {
+        return perSample.mean();
+    }
+    std::vector<double> w;
+    w.reserve(positions.size());
+    for (size_t p : positions) w.push_back(cursor.sampleWeights[p]);
+    return (perSample * torch::tensor(w, torch::kDouble).to(perSample.options())).mean();
+}
+
+void BaseTrainer::updateSampleLosses(TrainingCursor& cursor, const std::vector<size_t>& positions,
+                                     const torch::Tensor& perSample) {
+    if (!cursor.sampleLoss.defined()) return;
+    torch::NoGradGuard noGrad;
+    // Draws with replacement can repeat a sample within a micro-batch; its losses are
+    // averaged so every id is written once (index_copy_ leaves duplicates undefined)
+    std::vector<int64_t> ids, slots;
+    std::vector<float> counts;
+    std::unordered_map<int64_t, int64_t> slotOf;
+    for (size_t p : positions) {
+        auto [it, added] = slotOf.emplace(cursor.dataOrder[p], static_cast<int64_t>(ids.size()));
+        if (added) {
+            ids.push_back(it->first);
+            counts.push_back(0.f);
+        }
+        counts[it->second] += 1.f;
+        slots.push_back(it->second);
+    }
+
+    // Exponential moving average on the device; the first observation is taken as is
+    auto idx = torch::tensor(ids, torch::kLong).to(device);
+    auto fresh = torch::zeros({static_cast<int64_t>(ids.size())}, cursor.sampleLoss.options())
+                     .index_add_(0, torch::tensor(slots, torch::kLong).to(device), perSample.detach().to(torch::kFloat))
+                     .div_(torch::tensor(counts).to(device));
+    auto old = cursor.sampleLoss.index_select(0, idx);
+    auto blended = torch::where(old < 0, fresh, old * cfg.isSmoothing + fresh * (1.0 - cfg.isSmoothing));
+    cursor.sampleLoss.index_copy_(0, idx, blended);
 }
 
 } // namespace trainer
@@ -2,13 +2,26 @@
 
 #include "common/ArgParser.hpp"
 #include "common/Exception.hpp"
+#include "common/ProgressReporter.hpp"
+#include "common/Runtime.hpp"
 #include "common/Utils.hpp"
 #include "common/Visualizer.hpp"
+#include "common/WorkerPool.hpp"
 #include "evaluation/Benchmark.hpp"
 #include "data/ImageLoader.hpp"
 #include "models/BaseModel.hpp"
+#include "AsyncValidator.hpp"
+#include "Checkpoint.hpp"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>
+#include <numeric>
+#include <random>
 #include <string>
+#include <vector>
 #include <torch/torch.h>
 
 namespace med {
@@ -29,16 +42,168 @@ public:
     // Evaluate (inference + metrics) (pure virtual)
     virtual void evaluate() = 0;
 
+    // Post-training quantization: run up to numSamples training images (spread over the
+    // train split) through the model in eval mode, e.g. between setCalibration(true/false)
+    virtual void calibrate(size_t numSamples) = 0;
+
+    // Headline metric of the last evaluate() (Dice / accuracy; 0 if nothing was evaluated)
+    double testScore() const { return lastTestScore; }
+
 protected:
     std::shared_ptr<models::BaseModel> model;
     const common::Config& cfg;
     torch::Device device;
+    double lastTestScore = 0.0; // set by evaluate()
+
+    // Utility: create the fused optimizer selected by cfg.optimizer for the given model
+    optim::FusedOptimizer makeOptimizer();
+
+    // Full training resolution of the model (cfg.imageSize or the model default)
+    cv::Size fullSize() const;
+
+    // Progressive resizing: training resolution of `epoch` under cfg.resizeSchedule
+    // (the schedule's stages are spread evenly over the epochs; full size when empty)
+    cv::Size epochSize(size_t epoch) const;
+
+    // Every resolution the schedule trains at, for ImageLoader's multi-resolution cache
+    std::vector<cv::Size> scheduleSizes() const;
+
+    // Move a [B,C,H,W] input batch to the device, channels-last when cfg.channelsLast is set
+    torch::Tensor toInput(const torch::Tensor& batch) const;
+
+    // Gradient accumulation: each micro-batch backpropagates its mean loss times the
+    // samples it actually used (skipped samples count for nothing), so the accumulated
+    // gradient is a sum over the window's used samples; this divides it by their count
+    // (`windowSamples`, reset to 0), steps and zeroes the gradients. Returns false without
+    // stepping when every sample of the window was skipped.
+    bool stepAccumulated(optim::FusedOptimizer& optimizer, size_t& windowSamples);
+
+    // Gradient accumulation: true if micro-batch `batchIdx` closes a window (time to step)
+    bool isStepBoundary(size_t batchIdx, size_t numBatches) const;
+
+    // Training loop bookkeeping: a fresh cursor, or the one restored from cfg.resumePath
+    TrainingCursor beginTraining(optim::FusedOptimizer& optimizer, size_t numSamples);
+
+    // Move the cursor to the first micro-batch of the next epoch
+    void advanceEpoch(TrainingCursor& cursor, size_t numSamples);
+
+    // Per-step bookkeeping without host synchronization: the loss is summed on the
+    // device and only read back every cfg.logEvery micro-batches; progress is published
+    // to the reporter thread
+    void recordStep(const torch::Tensor& loss, TrainingCursor& cursor, size_t totalBatches);
+
+    // Fold the on-device loss sum into cursor.epochLoss (one host sync)
+    void syncLoss(TrainingCursor& cursor);
+
+    // Read back the loss and print the final progress line of the epoch
+    void finishEpoch(TrainingCursor& cursor);
+
+    // Count an optimizer step taken at micro-batch `cursor.batchIdx`; every
+    // cfg.checkpointEvery steps, snapshot the run and hand it to the background writer
+    void afterOptimizerStep(const optim::FusedOptimizer& optimizer, TrainingCursor& cursor);
+
+    // Wait for pending checkpoint writes
+    void endTraining();
+
+    // Mean of the per-sample losses of the micro-batch at data-order `positions`; under
+    // importance sampling each is weighted by 1/(N p) so the estimate stays unbiased
+    torch::Tensor sampledMean(const torch::Tensor& perSample, const TrainingCursor& cursor,
+                              const std::vector<size_t>& positions) const;
+
+    // Importance sampling: fold the micro-batch's per-sample losses into the running estimates
+    void updateSampleLosses(TrainingCursor& cursor, const std::vector<size_t>& positions,
+                            const torch::Tensor& perSample);
+
+    // Deterministically move cfg.valSplit of `items` into `heldOut` (fixed seed, so the
+    // split does not depend on the torch RNG and is identical across resumed runs)
+    template <class T>
+    void splitValidation(std::vector<T>& items, std::vector<T>& heldOut) const {
+        size_t numHeldOut = static_cast<size_t>(cfg.valSplit * static_cast<double>(items.size()));
+        if (numHeldOut == 0) return;
+        std::vector<size_t> idx(items.size());
+        std::iota(idx.begin(), idx.end(), 0);
+        std::mt19937 rng(42);
+        std::shuffle(idx.begin(), idx.end(), rng);
+        std::vector<bool> held(items.size(), false);
+        for (size_t i = 0; i < numHeldOut; ++i) held[idx[i]] = true;
+
+        std::vector<T> kept;
+        for (size_t i = 0; i < items.size(); ++i) {
+            (held[i] ? heldOut : kept).push_back(items[i]);
+        }
+        items.swap(kept);
+    }
+
+    // Run `load` on the loader workers (pinned to the loader cores); with
+    // cfg.loaderWorkers == 0 it runs lazily on the thread that calls get()
+    template <class F>
+    auto loadAsync(F&& load) -> std::future<std::invoke_result_t<F>> {
+        if (loaderPool) return loaderPool->submit(std::forward<F>(load));
+        return std::async(std::launch::deferred, std::forward<F>(load));
+    }
+
+    // Like loadAsync(), but with cfg.loaderWorkers == 0 `load` runs right away on the
+    // calling thread; for producer threads whose futures are consumed elsewhere
+    template <class F>
+    auto loadEager(F&& load) -> std::future<std::invoke_result_t<F>> {
+        if (loaderPool) return loaderPool->submit(std::forward<F>(load));
+        std::packaged_task<std::invoke_result_t<F>()> task(std::forward<F>(load));
+        auto result = task.get_future();
+        task();
+        return result;
+    }
+
+    // Knowledge distillation (cfg.teacherPath): run the frozen teacher once over the
+    // training set and keep its outputs on the host, in dataset order. `loadSample(i)`
+    // returns the full-size [C,H,W] input of sample i; it runs on the loader workers and may
+    // throw or return an undefined tensor, which leaves that sample's row NaN (see distill()).
+    void cacheTeacherOutputs(size_t numSamples, const std::function<torch::Tensor(size_t)>& loadSample);
+
+    // Blend the per-sample ground-truth losses of the micro-batch at data-order `positions`
+    // with the distillation loss against their cached teacher outputs (no-op without a
+    // teacher; samples without a teacher output keep the ground-truth loss alone)
+    torch::Tensor distill(const torch::Tensor& gtPerSample, const torch::Tensor& output,
+                          const TrainingCursor& cursor, const std::vector<size_t>& positions) const;
+
+    // calibrate(): forward `numSamples` of `numAvailable` training images, evenly spaced,
+    // in batches of cfg.evalBatchSize. `loadImage(i)` returns image i ([C,H,W], full size)
+    // or an undefined tensor if it cannot be read.
+    void runCalibration(size_t numAvailable, size_t numSamples, const std::function<torch::Tensor(size_t)>& loadImage);
+
+    // Background validator on a fresh replica of the model; best weights go to <name>_best.pt.
+    // Create it before beginTraining(): its state is restored on resume and checkpointed.
+    std::unique_ptr<AsyncValidator> makeValidator(AsyncValidator::Job job);
+
+    // End of epoch: queue a validation pass (every cfg.valEvery epochs) and report the
+    // passes that finished meanwhile. Returns true when early stopping should trigger.
+    bool validateEpoch(AsyncValidator& validator, const TrainingCursor& cursor);
+
+    // Wait for the last validation pass and report it
+    void finishValidation(AsyncValidator& validator);
+
+private:
+    // Sample order of the cursor's epoch: every sample in order, or (importance sampling,
+    // after the warm-up epochs) cfg.isFraction * N draws weighted by the running losses
+    void drawEpoch(TrainingCursor& cursor, size_t numSamples) const;
+
+    // Print finished validation passes (and the time to cfg.targetScore once reached)
+    void reportValidation(const std::vector<ValidationResult>& results, const AsyncValidator& validator);
+
+    // The student's architecture with the teacher options, weights from cfg.teacherPath, frozen
+    std::shared_ptr<models::BaseModel> loadTeacher() const;
 
-    // Utility: create (and return) a torch::optim::Adam for the given model
-    torch::optim::Adam makeOptimizer();
+    std::unique_ptr<common::WorkerPool> loaderPool;
+    AsyncValidator* activeValidator = nullptr; // made by makeValidator(), until endTraining()
+    torch::Tensor teacherOutputs; // [N, ...] teacher logits (maps in half precision), host memory
+    std::unique_ptr<AsyncCheckpointWriter> checkpointWriter;
+    std::unique_ptr<util::ProgressReporter> reporter;
+    torch::Tensor deviceLossSum; // losses of micro-batches not yet read back
+    size_t pendingLosses = 0;
 
-    // Utility: print a progress bar (uses common::printProgressBar)
-    void printProgress(size_t current, size_t total);
+    // Time-to-target: wall time and step count when each validated epoch's weights were taken
+    std::chrono::steady_clock::time_point trainStart;
+    std::map<size_t, std::pair<double, size_t>> validatedAt;
+    bool targetReached = false;
 };
 
 } // namespace trainer
@@ -0,0 +1,264 @@
+#include "Checkpoint.hpp"
+#include "common/Exception.hpp"
+#include "common/Runtime.hpp"
+#include <ATen/CPUGeneratorImpl.h>
+#include <ATen/Context.h>
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace med {
+namespace trainer {
+
+// Detached host copy that does not alias the live tensor
+static torch::Tensor hostCopy(const torch::Tensor& t) {
+    return t.detach().to(torch::kCPU, /*non_blocking=*/false, /*copy=*/true);
+}
+
+// Names are stored as one newline-separated string next to indexed tensors
+static void writeTensorList(torch::serialize::OutputArchive& archive, const std::string& prefix,
+                            const std::vector<std::pair<std::string, torch::Tensor>>& tensors) {
+    std::string names;
+    for (size_t i = 0; i < tensors.size(); ++i) {
+        names += tensors[i].first + "\n";
+        archive.write(prefix + "_" + std::to_string(i), tensors[i].second);
+    }
+    archive.write(prefix + "_names", c10::IValue(names));
+}
+
+static std::vector<std::pair<std::string, torch::Tensor>>
+readTensorList(torch::serialize::InputArchive& archive, const std::string& prefix) {
+    c10::IValue namesValue;
+    archive.read(prefix + "_names", namesValue);
+    std::istringstream names(namesValue.toStringRef());
+
+    std::vector<std::pair<std::string, torch::Tensor>> out;
+    std::string name;
+    while (std::getline(names, name)) {
+        torch::Tensor t;
+        archive.read(prefix + "_" + std::to_string(out.size()), t);
+        out.emplace_back(name, t);
+    }
+    return out;
+}
+
+static void writeScalar(torch::serialize::OutputArchive& archive, const std::string& key, int64_t v) {
+    archive.write(key, torch::tensor(v, torch::kLong));
+}
+
+static int64_t readScalar(torch::serialize::InputArchive& archive, const std::string& key) {
+    torch::Tensor t;
+    archive.read(key, t);
+    return t.item<int64_t>();
+}
+
+// Default generator of every visible CUDA device (dropout masks and augmentation on the GPU)
+static std::vector<at::Generator> cudaGenerators() {
+    std::vector<at::Generator> gens;
+    if (!torch::cuda::is_available()) return gens;
+    for (size_t d = 0; d < torch::cuda::device_count(); ++d) {
+        gens.push_back(at::globalContext().defaultGenerator(
+            at::Device(at::kCUDA, static_cast<c10::DeviceIndex>(d))));
+    }
+    return gens;
+}
+
+TrainingState Checkpoint::capture(const models::BaseModel& model,
+                                  const optim::FusedOptimizer& optimizer,
+                                  const TrainingCursor& cursor) {
+    TrainingState state;
+    state.cursor = cursor;
+    if (cursor.sampleLoss.defined()) {
+        state.cursor.sampleLoss = hostCopy(cursor.sampleLoss);
+    }
+
+    for (const auto& item : model.named_parameters()) {
+        state.modelTensors.emplace_back(item.key(), hostCopy(item.value()));
+    }
+    for (const auto& item : model.named_buffers()) {
+        state.modelTensors.emplace_back(item.key(), hostCopy(item.value()));
+    }
+
+    state.optimizerTensors = optimizer.stateTensors();
+
+    auto gen = at::detail::getDefaultCPUGenerator();
+    {
+        std::lock_guard<std::mutex> lock(gen.mutex());
+        state.rngState = gen.get_state();
+    }
+    auto cudaGens = cudaGenerators();
+    for (size_t d = 0; d < cudaGens.size(); ++d) {
+        std::lock_guard<std::mutex> lock(cudaGens[d].mutex());
+        state.cudaRngStates.emplace_back("cuda:" + std::to_string(d), cudaGens[d].get_state());
+    }
+    return state;
+}
+
+void Checkpoint::restore(const TrainingState& state,
+                         models::BaseModel& model,
+                         optim::FusedOptimizer& optimizer) {
+    torch::NoGradGuard noGrad;
+
+    auto params = model.named_parameters();
+    auto buffers = model.named_buffers();
+    for (const auto& [name, src] : state.modelTensors) {
+        torch::Tensor* dst = params.find(name);
+        if (dst == nullptr) dst = buffers.find(name);
+        if (dst == nullptr || !dst->sizes().equals(src.sizes())) {
+            throw error::ModelException("checkpoint tensor '" + name + "' does not match the model");
+        }
+        dst->copy_(src);
+    }
+
+    optimizer.loadStateTensors(state.optimizerTensors);
+
+    if (state.rngState.defined()) {
+        auto gen = at::detail::getDefaultCPUGenerator();
+        std::lock_guard<std::mutex> lock(gen.mutex());
+        gen.set_state(state.rngState);
+    }
+    // Devices beyond those of the saving run keep their seed
+    auto cudaGens = cudaGenerators();
+    for (size_t d = 0; d < std::min(cudaGens.size(), state.cudaRngStates.size()); ++d) {
+        std::lock_guard<std::mutex> lock(cudaGens[d].mutex());
+        cudaGens[d].set_state(state.cudaRngStates[d].second);
+    }
+}
+
+void Checkpoint::write(const TrainingState& state, const std::string& path) {
+    torch::serialize::OutputArchive archive;
+    const auto& c = state.cursor;
+    writeScalar(archive, "epoch", static_cast<int64_t>(c.epoch));
+    writeScalar(archive, "batch_idx", static_cast<int64_t>(c.batchIdx));
+    writeScalar(archive, "global_step", static_cast<int64_t>(c.globalStep));
+    writeScalar(archive, "loss_count", static_cast<int64_t>(c.lossCount));
+    archive.write("epoch_loss", torch::tensor(c.epochLoss, torch::kDouble));
+    archive.write("data_order", torch::tensor(c.dataOrder, torch::kLong));
+    archive.write("sample_weights", torch::tensor(c.sampleWeights, torch::kDouble));
+    if (c.sampleLoss.defined()) {
+        archive.write("sample_loss", c.sampleLoss);
+    }
+    writeScalar(archive, "batch_size", static_cast<int64_t>(c.batchSize));
+    writeScalar(archive, "accumulate_steps", static_cast<int64_t>(c.accumulateSteps));
+    archive.write("best_score", torch::tensor(c.bestScore, torch::kDouble));
+    writeScalar(archive, "best_epoch", static_cast<int64_t>(c.bestEpoch));
+    writeScalar(archive, "passes_since_best", static_cast<int64_t>(c.passesSinceBest));
+    archive.write("rng_state", state.rngState);
+    writeTensorList(archive, "cuda_rng", state.cudaRngStates);
+    writeTensorList(archive, "model", state.modelTensors);
+    writeTensorList(archive, "optimizer", state.optimizerTensors);
+
+    std::string tmpPath = path + ".tmp";
+    try {
+        archive.save_to(tmpPath);
+        fs::rename(tmpPath, path);
+    } catch (const std::exception&) {
+        throw error::FileIOException(path, false);
+    }
+}
+
+TrainingState Checkpoint::read(const std::string& path) {
+    torch::serialize::InputArchive archive;
+    try {
+        archive.load_from(path);
+    } catch (const c10::Error&) {
+        throw error::FileIOException(path, true);
+    }
+
+    TrainingState state;
+    auto& c = state.cursor;
+    c.epoch = static_cast<size_t>(readScalar(archive, "epoch"));
+    c.batchIdx = static_cast<size_t>(readScalar(archive, "batch_idx"));
+    c.globalStep = static_cast<size_t>(readScalar(archive, "global_step"));
+    c.lossCount = static_cast<size_t>(readScalar(archive, "loss_count"));
+
+    torch::Tensor epochLoss, dataOrder;
+    archive.read("epoch_loss", epochLoss);
+    archive.read("data_order", dataOrder);
+    c.epochLoss = epochLoss.item<double>();
+    dataOrder = dataOrder.contiguous();
+    c.dataOrder.assign(dataOrder.data_ptr<int64_t>(), dataOrder.data_ptr<int64_t>() + dataOrder.numel());
+
+    // Importance-sampling state (absent in older checkpoints)
+    torch::Tensor sampleWeights;
+    if (archive.try_read("sample_weights", sampleWeights)) {
+        sampleWeights = sampleWeights.contiguous();
+        c.sampleWeights.assign(sampleWeights.data_ptr<double>(), sampleWeights.data_ptr<double>() + sampleWeights.numel());
+    }
+    torch::Tensor sampleLoss;
+    if (archive.try_read("sample_loss", sampleLoss)) {
+        c.sampleLoss = sampleLoss;
+    }
+
+    // Batch geometry and validation state (absent in older checkpoints)
+    torch::Tensor value;
+    if (archive.try_read("batch_size", value)) c.batchSize = static_cast<size_t>(value.item<int64_t>());
+    if (archive.try_read("accumulate_steps", value)) c.accumulateSteps = static_cast<size_t>(value.item<int64_t>());
+    if (archive.try_read("best_score", value)) c.bestScore = value.item<double>();
+    if (archive.try_read("best_epoch", value)) c.bestEpoch = static_cast<size_t>(value.item<int64_t>());
+    if (archive.try_read("passes_since_best", value)) c.passesSinceBest = static_cast<size_t>(value.item<int64_t>());
+
+    archive.read("rng_state", state.rngState);
+    c10::IValue cudaRngNames;
+    if (archive.try_read("cuda_rng_names", cudaRngNames)) { // absent in older checkpoints
+        state.cudaRngStates = readTensorList(archive, "cuda_rng");
+    }
+    state.modelTensors = readTensorList(archive, "model");
+    state.optimizerTensors = readTensorList(archive, "optimizer");
+    return state;
+}
+
+AsyncCheckpointWriter::AsyncCheckpointWriter(std::string path_)
+: path(std::move(path_)), worker(&AsyncCheckpointWriter::run, this) {}
+
+AsyncCheckpointWriter::~AsyncCheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+void AsyncCheckpointWriter::submit(TrainingState state) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending = std::move(state);
+    }
+    cv.notify_all();
+}
+
+void AsyncCheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return !pending && !writing; });
+}
+
+void AsyncCheckpointWriter::run() {
+    common::Runtime::pinCurrentThread(common::ThreadRole::IO);
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        cv.wait(lock, [this] { return pending || stopping; });
+        if (!pending) break; // stopping with nothing queued
+
+        TrainingState state = std::move(*pending);
+        pending.reset();
+        writing = true;
+        lock.unlock();
+
+        try {
+            Checkpoint::write(state, path);
+            std::cout << "\n[INFO] Checkpoint (step " << state.cursor.globalStep << ") saved to " << path << "\n";
+        } catch (const std::exception& e) {
+            std::cerr << "\n[WARN] Checkpoint write failed: " << e.what() << "\n";
+        }
+
+        lock.lock();
+        writing = false;
+        cv.notify_all();
+    }
+}
+
+} // namespace trainer
+} // namespace med
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "models/BaseModel.hpp"
+#include "optim/FusedOptimizer.hpp"
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <torch/torch.h>
+
+namespace med {
+namespace trainer {
+
+// Position of the training loop (everything besides tensors needed to resume)
+struct TrainingCursor {
+    size_t epoch = 1;                  // epoch in progress (1-based)
+    size_t batchIdx = 0;               // next micro-batch inside the epoch
+    size_t globalStep = 0;             // optimizer steps taken so far
+    double epochLoss = 0.0;            // running loss sum of the current epoch
+    size_t lossCount = 0;              // micro-batches summed into epochLoss
+    std::vector<int64_t> dataOrder;    // sample order of the current epoch
+    std::vector<double> sampleWeights; // importance weight 1/(N p) per dataOrder entry (empty = uniform)
+    torch::Tensor sampleLoss;          // running loss of every sample (importance sampling; -1 = unseen)
+    size_t batchSize = 0;              // batch geometry of the run (0 = not recorded)
+    size_t accumulateSteps = 0;
+    // AsyncValidator state, so early stopping and <name>_best.pt carry over a resume
+    double bestScore = -std::numeric_limits<double>::infinity();
+    size_t bestEpoch = 0;
+    size_t passesSinceBest = 0;
+};
+
+// Host-side snapshot of a training run: cursor + weights + optimizer state + RNG
+struct TrainingState {
+    TrainingCursor cursor;
+    torch::Tensor rngState;            // default CPU generator state
+    std::vector<std::pair<std::string, torch::Tensor>> cudaRngStates;     // default CUDA generator state per device
+    std::vector<std::pair<std::string, torch::Tensor>> modelTensors;      // parameters & buffers
+    std::vector<std::pair<std::string, torch::Tensor>> optimizerTensors;  // FusedOptimizer moments + step
+};
+
+// Capture / restore / (de)serialize training snapshots
+class Checkpoint {
+public:
+    // Deep-copy model, optimizer state and RNG into host memory (call between optimizer steps)
+    static TrainingState capture(const models::BaseModel& model,
+                                 const optim::FusedOptimizer& optimizer,
+                                 const TrainingCursor& cursor);
+
+    // Copy a snapshot back into the model, the optimizer and the RNG
+    static void restore(const TrainingState& state,
+                        models::BaseModel& model,
+                        optim::FusedOptimizer& optimizer);
+
+    // Write a snapshot to `path` (written to `path.tmp`, then atomically renamed)
+    static void write(const TrainingState& state, const std::string& path);
+
+    // Read a snapshot written by write()
+    static TrainingState read(const std::string& path);
+};
+
+// Serializes snapshots on a background thread so the training loop never waits on disk.
+// At most one snapshot is queued: a newer submit() replaces one that has not started yet.
+class AsyncCheckpointWriter {
+public:
+    explicit AsyncCheckpointWriter(std::string path);
+
+    // Flushes the queued snapshot and joins the worker
+    ~AsyncCheckpointWriter();
+
+    AsyncCheckpointWriter(const AsyncCheckpointWriter&) = delete;
+    AsyncCheckpointWriter& operator=(const AsyncCheckpointWriter&) = delete;
+
+    // Queue a snapshot for writing
+    void submit(TrainingState state);
+
+    // Block until every queued snapshot is on disk
+    void flush();
+
+private:
+    void run();
+
+    std::string path;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::optional<TrainingState> pending;
+    bool writing = false;
+    bool stopping = false;
+    std::thread worker;
+};
+
+} // namespace trainer
+} // namespace med
@@ -1,4 +1,7 @@
 #include "ClassificationTrainer.hpp"
+#include "data/FeatureCache.hpp"
+#include "evaluation/TestTimeAugmentation.hpp"
+#include <unordered_set>
 
 namespace fs = std::filesystem;
 
@@ -10,9 +13,9 @@ ClassificationTrainer::ClassificationTrainer(std::shared_ptr<models::BaseModel>
     if (cfg.clsTrainDir.empty()) {
         throw error::ConfigException("ClassificationTrainer", "Missing --train-dir for classification");
     }
-    // Build class list from subdirectories under clsTrainDir
+    // Build class list from subdirectories under clsTrainDir ("cache" belongs to ImageLoader)
     for (auto& p : fs::directory_iterator(cfg.clsTrainDir)) {
-        if (p.is_directory()) {
+        if (p.is_directory() && p.path().filename() != "cache") {
             std::string clsName = p.path().filename().string();
             int idx = static_cast<int>(classes.size());
             classes.push_back(clsName);
@@ -28,6 +31,15 @@ ClassificationTrainer::ClassificationTrainer(std::shared_ptr<models::BaseModel>
     for (int i = 0; i < (int)classes.size(); ++i) {
         classToIdx[classes[i]] = i;
     }
+
+    // Weights loaded from another task re-bind the head to their own class count; only the
+    // backbone is kept then, and the head starts afresh with one output per class
+    auto head = this->model->head();
+    if (head && head->options.out_features() != static_cast<int64_t>(classes.size())) {
+        std::cout << "[INFO] Head has " << head->options.out_features() << " outputs for "
+                  << classes.size() << " classes; re-initializing it\n";
+        this->model->resetHead(static_cast<int>(classes.size()));
+    }
 }
 
 std::vector<std::pair<std::string,int>> 
@@ -50,64 +62,351 @@ ClassificationTrainer::makeFileLabelList(const std::string& rootDir) {
 }
 
 void ClassificationTrainer::train() {
-    // Build train list <filename, label>
+    // Build train list <filename, label>, minus the held-out validation split
     auto trainList = makeFileLabelList(cfg.clsTrainDir);
+    std::vector<std::pair<std::string,int>> valList;
+    splitValidation(trainList, valList);
 
     // If a test‐dir was given, build test list but we only use trainList here
     if (!cfg.clsTestDir.empty()) {
         // (we may evaluate on it later in evaluate())
     }
 
-    data::ImageLoader imgLoader(cfg.clsTrainDir, cv::Size(224,224));
-    // We'll assume images are RGB; loader takes raw, then you do matToTensor + normalize
-    // Here, factory‐normalize each image to [0,1] and treat as single‐channel or 3‐channel?
-    // For brevity, we’ll do: matToTensor yields [1,H,W] -> duplicate to 3 channels:
-    // loader.matToTensor yields single‐channel float; we tile it to 3 channels.
+    // Full-size loader that also caches every resolution of the resize schedule
+    data::ImageLoader imgLoader(cfg.clsTrainDir, fullSize(), scheduleSizes());
+    // loader.matToTensor yields single‐channel float; toChannels() tiles it to 3 channels
+    // only when the model has an RGB-style stem (--in-channels 3).
+
+    if (cfg.headOnly) {
+        trainHead(imgLoader, trainList, valList);
+        return;
+    }
 
-    torch::optim::Adam optimizer = makeOptimizer();
+    optim::FusedOptimizer optimizer = makeOptimizer();
     model->train();
 
-    size_t totalBatches = trainList.size();
-    for (size_t epoch = 1; epoch <= cfg.epochs; ++epoch) {
-        double epochLoss = 0.0;
-        size_t count = 0;
+    // Validation runs concurrently on a replica of the model
+    std::unique_ptr<AsyncValidator> validator;
+    if (!valList.empty()) {
+        validator = makeValidator([&](models::BaseModel& replica) {
+            return validate(replica, imgLoader, valList);
+        });
+    }
 
-        for (auto& [fname, label] : trainList) {
-            // Find which class folder contains fname
-            // Actually, loader.loadRaw expects full path; combine as rootDir/class/fname
-            std::string clsName = classes[label];
-            std::string fullPath = cfg.clsTrainDir + "/" + clsName + "/" + fname;
-            cv::Mat raw = imgLoader.loadRaw(fullPath);
-            if (raw.empty()) continue;
+    size_t numSamples = trainList.size();
 
-            // Preprocess: resize, matToTensor
-            auto imgT = imgLoader.process(raw); // [1,H,W] float
-            // Expand to 3 channels by repeating
-            auto img3 = torch::cat({imgT, imgT, imgT}, 0).unsqueeze(0).to(device); // [1,3,H,W]
+    // Distillation: teacher logits of every training image, computed once
+    cacheTeacherOutputs(numSamples, [&](size_t i) {
+        const auto& [fname, label] = trainList[i];
+        return toChannels(imgLoader.loadCached(samplePath(fname, label)));
+    });
 
-            // Create target tensor
-            torch::Tensor target = torch::tensor(label, torch::kLong).unsqueeze(0).to(device);
+    // Queue the samples of one micro-batch on the loader workers (position in the epoch's
+    // data order, [C,H,W] image + label; the image is undefined when it could not be read)
+    using Sample = std::tuple<size_t, torch::Tensor, int64_t>;
+    auto fetchBatch = [&](size_t batchIdx, const std::vector<int64_t>& order, cv::Size size) {
+        std::vector<std::future<Sample>> samples;
+        size_t first = batchIdx * cfg.batchSize;
+        size_t last = std::min(order.size(), first + cfg.batchSize);
+        for (size_t i = first; i < last; ++i) {
+            const auto& [fname, label] = trainList[order[i]];
+            std::string path = samplePath(fname, label);
+            samples.push_back(loadAsync([this, &imgLoader, i, path, size, label = label] {
+                // This epoch's resolution from the cache; decoded once for all sizes on a miss
+                try {
+                    auto imgT = imgLoader.loadCached(path, size); // [1,H,W] float
+                    return Sample(i, toChannels(imgT), label);    // [C,H,W]
+                } catch (const std::exception& e) {
+                    std::cerr << "[WARN] Training skips " << path << ": " << e.what() << "\n";
+                    return Sample(i, torch::Tensor(), label);
+                }
+            }));
+        }
+        return samples;
+    };
 
-            // Forward pass
-            auto logits = model->predict(img3);
-            auto loss = torch::nn::functional::cross_entropy(logits, target);
+    TrainingCursor cursor = beginTraining(optimizer, numSamples);
+    size_t windowSamples = 0; // samples used since the last optimizer step (checkpoints sit on step boundaries)
+    for (; cursor.epoch <= cfg.epochs; advanceEpoch(cursor, numSamples)) {
+        optimizer.zero_grad();
+        windowSamples = 0;
+        // Importance sampling may draw fewer samples than the dataset holds
+        size_t epochSamples = cursor.dataOrder.size();
+        size_t totalBatches = (epochSamples + cfg.batchSize - 1) / cfg.batchSize;
+        cv::Size size = epochSize(cursor.epoch);
+        if (!cfg.resizeSchedule.empty()) {
+            std::cout << "\n[INFO] Epoch " << cursor.epoch << ": training at " << size.width << "x" << size.height << "\n";
+        }
+        auto nextBatch = fetchBatch(cursor.batchIdx, cursor.dataOrder, size);
+        for (; cursor.batchIdx < totalBatches; ++cursor.batchIdx) {
+            // Gather one micro-batch; the next one loads meanwhile
+            auto batch = std::move(nextBatch);
+            if (cursor.batchIdx + 1 < totalBatches) {
+                nextBatch = fetchBatch(cursor.batchIdx + 1, cursor.dataOrder, size);
+            }
+            std::vector<torch::Tensor> imgs;
+            std::vector<int64_t> labels;
+            std::vector<size_t> positions;
+            for (auto& sample : batch) {
+                auto [position, imgT, label] = sample.get();
+                if (!imgT.defined()) continue;
+                imgs.push_back(imgT);
+                labels.push_back(label);
+                positions.push_back(position);
+            }
 
-            optimizer.zero_grad();
-            loss.backward();
-            optimizer.step();
+            torch::Tensor loss;
+            if (!imgs.empty()) {
+                auto input = toInput(torch::stack(imgs)); // [B,C,H,W]
+
+                // Create target tensor
+                torch::Tensor target = torch::tensor(labels, torch::kLong).to(device);
+
+                // Forward pass
+                auto logits = model->predict(input);
+                auto perSample = torch::nn::functional::cross_entropy(logits, target,
+                    torch::nn::functional::CrossEntropyFuncOptions().reduction(torch::kNone));
+                perSample = distill(perSample, logits, cursor, positions);
+                updateSampleLosses(cursor, positions, perSample);
+                loss = sampledMean(perSample, cursor, positions);
+
+                // Sum over the used samples; stepAccumulated() divides by the window's total
+                (loss * static_cast<double>(imgs.size())).backward();
+                windowSamples += imgs.size();
+            }
+
+            // Loss stays on the device; the progress bar is drawn by the reporter thread
+            recordStep(loss, cursor, totalBatches);
+
+            if (isStepBoundary(cursor.batchIdx, totalBatches) && stepAccumulated(optimizer, windowSamples)) {
+                afterOptimizerStep(optimizer, cursor);
+            }
+        }
+        finishEpoch(cursor);
+        if (validator && validateEpoch(*validator, cursor)) break;
+    }
+    if (validator) finishValidation(*validator);
+    endTraining();
+}
+
+ValidationResult ClassificationTrainer::validate(models::BaseModel& replica,
+                                                 data::ImageLoader& imgLoader,
+                                                 const std::vector<std::pair<std::string,int>>& valList) const {
+    double lossSum = 0.0;
+    size_t correct = 0, count = 0;
+    for (size_t first = 0; first < valList.size(); first += cfg.batchSize) {
+        std::vector<torch::Tensor> imgs;
+        std::vector<int64_t> labels;
+        size_t last = std::min(valList.size(), first + cfg.batchSize);
+        for (size_t i = first; i < last; ++i) {
+            const auto& [fname, label] = valList[i];
+            std::string path = samplePath(fname, label);
+            torch::Tensor imgT;
+            try {
+                imgT = imgLoader.loadCached(path);
+            } catch (const std::exception& e) {
+                std::cerr << "[WARN] Validation skips " << path << ": " << e.what() << "\n";
+            }
+            if (!imgT.defined()) continue;
+            imgs.push_back(toChannels(imgT));
+            labels.push_back(label);
+        }
+        if (imgs.empty()) continue;
 
-            epochLoss += loss.item<double>();
-            ++count;
+        auto input = toInput(torch::stack(imgs));
+        auto target = torch::tensor(labels, torch::kLong).to(device);
+        auto logits = replica.predict(input);
 
-            printProgress(count, totalBatches);
-            std::cout << "  Epoch " << epoch << "/" << cfg.epochs 
-                      << ", Batch " << count << "/" << totalBatches
-                      << ", AvgLoss=" << (epochLoss / std::max<size_t>(1, count)) << "\r";
+        lossSum += torch::nn::functional::cross_entropy(logits, target,
+            torch::nn::functional::CrossEntropyFuncOptions().reduction(torch::kSum)).item<double>();
+        correct += static_cast<size_t>(logits.argmax(1).eq(target).sum().item<int64_t>());
+        count += imgs.size();
+    }
+
+    ValidationResult result;
+    result.scoreName = "Accuracy";
+    result.loss = lossSum / std::max<size_t>(1, count);
+    result.score = static_cast<double>(correct) / std::max<size_t>(1, count);
+    return result;
+}
+
+std::string ClassificationTrainer::samplePath(const std::string& fname, int label) const {
+    return classes[label] + "/" + fname;
+}
+
+torch::Tensor ClassificationTrainer::toChannels(const torch::Tensor& imgT) const {
+    return cfg.inChannels == 1 ? imgT : imgT.repeat({cfg.inChannels, 1, 1});
+}
+
+std::pair<torch::Tensor, torch::Tensor>
+ClassificationTrainer::embedList(data::ImageLoader& imgLoader,
+                                 const std::vector<std::pair<std::string,int>>& list) {
+    model->eval();
+    torch::NoGradGuard noGrad;
+
+    using Sample = std::pair<torch::Tensor, int64_t>;
+    std::vector<torch::Tensor> embeddings;
+    std::vector<int64_t> labels;
+    for (size_t first = 0; first < list.size(); first += cfg.batchSize) {
+        size_t last = std::min(list.size(), first + cfg.batchSize);
+        std::vector<std::future<Sample>> samples;
+        for (size_t i = first; i < last; ++i) {
+            const auto& [fname, label] = list[i];
+            std::string path = samplePath(fname, label);
+            samples.push_back(loadAsync([this, &imgLoader, path, label = label] {
+                return Sample(toChannels(imgLoader.loadCached(path)), label);
+            }));
+        }
+        std::vector<torch::Tensor> imgs;
+        for (auto& sample : samples) {
+            auto [imgT, label] = sample.get();
+            if (!imgT.defined()) continue;
+            imgs.push_back(imgT);
+            labels.push_back(label);
+        }
+        if (imgs.empty()) continue;
+        embeddings.push_back(model->embed(toInput(torch::stack(imgs))).to(torch::kCPU, torch::kFloat));
+        util::printProgressBar(last, list.size(), cfg.printBarWidth);
+    }
+    std::cout << "\n";
+    model->train();
+
+    if (embeddings.empty()) {
+        throw error::DataProcessingException("embedding", "no readable images to embed");
+    }
+    return {torch::cat(embeddings), torch::tensor(labels, torch::kLong)};
+}
+
+uint64_t ClassificationTrainer::featureFingerprint(const std::vector<std::pair<std::string,int>>& list) {
+    // FNV-1a over the sample list, the input size and per-tensor statistics of every
+    // backbone parameter/buffer (the head is excluded: training it keeps the cache valid)
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const void* bytes, size_t n) {
+        const auto* p = static_cast<const unsigned char*>(bytes);
+        for (size_t i = 0; i < n; ++i) {
+            hash ^= p[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    for (const auto& [fname, label] : list) {
+        mix(fname.data(), fname.size());
+        mix(&label, sizeof(label));
+    }
+    cv::Size size = fullSize();
+    mix(&size.width, sizeof(size.width));
+    mix(&size.height, sizeof(size.height));
+
+    std::unordered_set<const void*> headTensors;
+    for (const auto& p : model->head()->parameters()) headTensors.insert(p.unsafeGetTensorImpl());
+    std::vector<torch::Tensor> stats;
+    {
+        torch::NoGradGuard noGrad;
+        for (const auto& t : model->parameters()) {
+            if (headTensors.count(t.unsafeGetTensorImpl())) continue;
+            stats.push_back(torch::stack({t.sum(), t.abs().sum()}).to(torch::kDouble));
+        }
+        for (const auto& t : model->buffers()) {
+            if (t.is_floating_point()) stats.push_back(torch::stack({t.sum(), t.abs().sum()}).to(torch::kDouble));
+        }
+    }
+    if (!stats.empty()) {
+        // One device read-back for all statistics
+        auto host = torch::cat(stats).to(torch::kCPU).contiguous();
+        mix(host.data_ptr<double>(), host.numel() * sizeof(double));
+    }
+    return hash;
+}
+
+void ClassificationTrainer::trainHead(data::ImageLoader& imgLoader,
+                                      const std::vector<std::pair<std::string,int>>& trainList,
+                                      const std::vector<std::pair<std::string,int>>& valList) {
+    torch::nn::Linear head = model->head();
+    if (!head) {
+        throw error::ModelException("--head-only needs a model with a classification head");
+    }
+    std::string path = cfg.featureCachePath.empty()
+        ? (cfg.modelName.empty() ? "model" : cfg.modelName) + "_features.bin"
+        : cfg.featureCachePath;
+
+    // Reuse the cache only if it was built from the same backbone and samples
+    uint64_t fingerprint = featureFingerprint(trainList);
+    std::unique_ptr<data::FeatureCache> cache;
+    if (fs::exists(path)) {
+        try {
+            cache = std::make_unique<data::FeatureCache>(path);
+            if (cache->fingerprint() != fingerprint) {
+                std::cout << "[INFO] Feature cache " << path << " is stale; rebuilding\n";
+                cache.reset();
+            }
+        } catch (const error::Exception& e) {
+            std::cerr << "[WARN] " << e.what() << "; rebuilding\n";
+            cache.reset();
+        }
+    }
+    if (!cache) {
+        std::cout << "[INFO] Embedding " << trainList.size() << " training images\n";
+        auto [features, labels] = embedList(imgLoader, trainList);
+        data::FeatureCache::write(path, features, labels, fingerprint);
+        cache = std::make_unique<data::FeatureCache>(path);
+    }
+    std::cout << "[INFO] Feature cache " << path << ": " << cache->size() << " x " << cache->dim() << "\n";
+
+    torch::Tensor valFeatures, valLabels;
+    if (!valList.empty()) {
+        std::tie(valFeatures, valLabels) = embedList(imgLoader, valList);
+        valFeatures = valFeatures.to(device);
+        valLabels = valLabels.to(device);
+    }
+
+    // Only the head is optimized; the mapped features never leave the page cache
+    // except for the rows of the current batch
+    auto features = cache->features();
+    auto labels = cache->labels();
+    optim::FusedOptimizer optimizer(head->parameters(), optim::optionsFromConfig(cfg));
+    const int64_t N = cache->size();
+    const int64_t B = static_cast<int64_t>(cfg.batchSize);
+
+    for (size_t epoch = 1; epoch <= cfg.epochs; ++epoch) {
+        auto start = std::chrono::steady_clock::now();
+        auto order = torch::randperm(N, torch::kLong);
+        auto lossSum = torch::zeros({}, torch::TensorOptions().device(device));
+        for (int64_t first = 0; first < N; first += B) {
+            auto idx = order.slice(0, first, std::min(N, first + B));
+            auto x = features.index_select(0, idx).to(device);
+            auto y = labels.index_select(0, idx).to(device);
+
+            optimizer.zero_grad();
+            auto loss = torch::nn::functional::cross_entropy(head->forward(x), y,
+                torch::nn::functional::CrossEntropyFuncOptions().reduction(torch::kSum));
+            (loss / idx.size(0)).backward();
+            optimizer.step();
+            lossSum += loss.detach();
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "[INFO] Head epoch " << epoch << "/" << cfg.epochs
+                  << ": loss " << lossSum.item<double>() / std::max<int64_t>(1, N)
+                  << " (" << ms << " ms)";
+        if (valFeatures.defined()) {
+            torch::NoGradGuard noGrad;
+            double acc = head->forward(valFeatures).argmax(1).eq(valLabels).to(torch::kDouble).mean().item<double>();
+            std::cout << ", val accuracy " << acc;
         }
         std::cout << "\n";
     }
 }
 
+void ClassificationTrainer::calibrate(size_t numSamples) {
+    auto trainList = makeFileLabelList(cfg.clsTrainDir);
+    std::vector<std::pair<std::string,int>> valList;
+    splitValidation(trainList, valList);
+
+    data::ImageLoader imgLoader(cfg.clsTrainDir, fullSize());
+    runCalibration(trainList.size(), numSamples, [&](size_t i) {
+        const auto& [fname, label] = trainList[i];
+        return toChannels(imgLoader.loadCached(samplePath(fname, label)));
+    });
+}
+
 void ClassificationTrainer::evaluate() {
     if (cfg.clsTestDir.empty()) {
         std::cerr << "[INFO] No test directory provided; skipping classification evaluation.\n";
@@ -116,31 +415,49 @@ void ClassificationTrainer::evaluate() {
 
     // Build test list
     auto testList = makeFileLabelList(cfg.clsTestDir);
-    data::ImageLoader imgLoader(cfg.clsTestDir, cv::Size(224,224));
+    data::ImageLoader imgLoader(cfg.clsTestDir, fullSize());
     eval::Benchmark bench;
 
     model->eval();
-    torch::NoGradGuard no_grad;
-
-    size_t correct = 0, total = 0;
-    for (auto& [fname, gtLabel] : testList) {
-        // Determine which class folder fname belongs to; same as train
-        std::string clsName = classes[gtLabel];
-        std::string fullPath = cfg.clsTestDir + "/" + clsName + "/" + fname;
-        cv::Mat raw = imgLoader.loadRaw(fullPath);
-        if (raw.empty()) continue;
+    torch::InferenceMode inferenceMode;
 
-        auto imgT = imgLoader.process(raw);
-        auto img3 = torch::cat({imgT, imgT, imgT}, 0).unsqueeze(0).to(device);
-        auto logits = model->predict(img3);
-        auto pred = logits.argmax(1).item<int>();
+    // Images of one batch are decoded on the loader workers; labels are compared on the
+    // device and read back once per batch
+    using Sample = std::pair<torch::Tensor, int64_t>;
+    auto correctCount = torch::zeros({}, torch::TensorOptions().dtype(torch::kLong).device(device));
+    size_t total = 0;
+    for (size_t first = 0; first < testList.size(); first += cfg.evalBatchSize) {
+        size_t last = std::min(testList.size(), first + cfg.evalBatchSize);
+        std::vector<std::future<Sample>> samples;
+        for (size_t i = first; i < last; ++i) {
+            // Determine which class folder fname belongs to; same as train
+            const auto& [fname, gtLabel] = testList[i];
+            std::string fullPath = cfg.clsTestDir + "/" + classes[gtLabel] + "/" + fname;
+            samples.push_back(loadAsync([this, &imgLoader, fullPath, gtLabel = gtLabel] {
+                cv::Mat raw = imgLoader.loadRaw(fullPath);
+                if (raw.empty()) return Sample(torch::Tensor(), gtLabel);
+                return Sample(toChannels(imgLoader.process(raw)), gtLabel);
+            }));
+        }
+        std::vector<torch::Tensor> imgs;
+        std::vector<int64_t> labels;
+        for (auto& sample : samples) {
+            auto [imgT, label] = sample.get();
+            if (!imgT.defined()) continue;
+            imgs.push_back(imgT);
+            labels.push_back(label);
+        }
+        if (imgs.empty()) continue;
 
-        if (pred == gtLabel) 
-            ++correct;
-        ++total;
+        auto logits = eval::TestTimeAugmentation::predict(*model, toInput(torch::stack(imgs)), cfg.ttaViews);
+        auto target = torch::tensor(labels, torch::kLong).to(device);
+        correctCount += logits.argmax(1).eq(target).sum();
+        total += imgs.size();
     }
+    size_t correct = static_cast<size_t>(correctCount.item<int64_t>());
     if (total > 0) {
         double acc = static_cast<double>(correct) / total;
+        lastTestScore = acc;
         std::cout << "Classification accuracy: " << (100.0 * acc) << "% (" 
                   << correct << "/" << total << ")\n";
     }
@@ -19,10 +19,37 @@ public:
     // Evaluate on a directory of class‐subdirectories
     void evaluate() override;
 
+    // Forward a sample of the train split (int8 calibration)
+    void calibrate(size_t numSamples) override;
+
 private:
     // Build a (filename, label) list from a root directory
     std::vector<std::pair<std::string,int>> makeFileLabelList(const std::string& rootDir);
 
+    // Path of a listed sample relative to the train directory (class folder/file)
+    std::string samplePath(const std::string& fname, int label) const;
+
+    // Grayscale [1,H,W] image as model input ([3,H,W] replicas for a 3-channel stem)
+    torch::Tensor toChannels(const torch::Tensor& imgT) const;
+
+    // Validation pass on the held-out list (runs on the validator thread): loss and accuracy
+    ValidationResult validate(models::BaseModel& replica,
+                              data::ImageLoader& imgLoader,
+                              const std::vector<std::pair<std::string,int>>& valList) const;
+
+    // Head-only fine-tuning: embed the train split once (kept in a memory-mapped
+    // FeatureCache file), then train only model->head() on the cached embeddings
+    void trainHead(data::ImageLoader& imgLoader,
+                   const std::vector<std::pair<std::string,int>>& trainList,
+                   const std::vector<std::pair<std::string,int>>& valList);
+
+    // Backbone embeddings [N,D] (CPU float) and labels [N] of a list, in eval mode
+    std::pair<torch::Tensor, torch::Tensor> embedList(data::ImageLoader& imgLoader,
+                                                     const std::vector<std::pair<std::string,int>>& list);
+
+    // Hash of the backbone weights, input size and sample list a feature cache was built from
+    uint64_t featureFingerprint(const std::vector<std::pair<std::string,int>>& list);
+
     // Map class‐name -> label id (0..N‐1)
     std::vector<std::string> classes;
     std::unordered_map<std::string,int> classToIdx;
@@ -1,10 +1,42 @@
 #include "SegmentationTrainer.hpp"
+#include "common/BoundedQueue.hpp"
+#include "evaluation/TestTimeAugmentation.hpp"
+#include "evaluation/TiledPredictor.hpp"
+#include <exception>
+#include <mutex>
+#include <random>
+#include <thread>
 
 namespace fs = std::filesystem;
 
 namespace med {
 namespace trainer {
 
+namespace {
+
+// n x n window of a [C,H,W] tensor; (fy, fx) in [0,1] place it within the free range.
+// Sides shorter than n are zero-padded at the bottom and right first.
+torch::Tensor cropWindow(torch::Tensor t, int64_t n, double fy, double fx) {
+    int64_t padH = std::max<int64_t>(0, n - t.size(1)), padW = std::max<int64_t>(0, n - t.size(2));
+    if (padH > 0 || padW > 0) t = torch::constant_pad_nd(t, {0, padW, 0, padH});
+    int64_t top = std::min(t.size(1) - n, static_cast<int64_t>(fy * (t.size(1) - n + 1)));
+    int64_t left = std::min(t.size(2) - n, static_cast<int64_t>(fx * (t.size(2) - n + 1)));
+    return t.narrow(1, top, n).narrow(2, left, n);
+}
+
+// The same native-resolution window of an image and its mask (crop training)
+std::pair<torch::Tensor, torch::Tensor> loadCropPair(data::ImageLoader& imgLoader, data::ImageLoader& mskLoader,
+                                                    const std::string& fname, int64_t n, double fy, double fx) {
+    auto img = imgLoader.loadNative(fname);
+    auto msk = mskLoader.loadNative(fname);
+    if (img.sizes() != msk.sizes()) {
+        throw error::DataProcessingException("train-crop", fname + ": image and mask sizes differ");
+    }
+    return {cropWindow(img, n, fy, fx), cropWindow(msk, n, fy, fx)};
+}
+
+} // namespace
+
 SegmentationTrainer::SegmentationTrainer(std::shared_ptr<models::BaseModel> model,
                                          const common::Config& cfg)
 : BaseTrainer(std::move(model), cfg) {
@@ -33,6 +65,7 @@ void SegmentationTrainer::loadFileLists() {
         trainImageFiles.push_back(fname);
     }
     std::sort(trainImageFiles.begin(), trainImageFiles.end());
+    splitValidation(trainImageFiles, valImageFiles);
 
     // If test dir provided, load test images (masks optional)
     if (!cfg.segTestDir.empty()) {
@@ -49,53 +82,180 @@ void SegmentationTrainer::loadFileLists() {
 }
 
 void SegmentationTrainer::train() {
-    data::ImageLoader imgLoader(cfg.segTrainDir + "/image", cv::Size(256,256));
-    data::ImageLoader mskLoader(cfg.segTrainDir + "/mask", cv::Size(256,256));
+    // Full-size loaders that also cache every resolution of the resize schedule
+    data::ImageLoader imgLoader(cfg.segTrainDir + "/image", fullSize(), scheduleSizes());
+    data::ImageLoader mskLoader(cfg.segTrainDir + "/mask", fullSize(), scheduleSizes());
 
-    torch::optim::Adam optimizer = makeOptimizer();
+    optim::FusedOptimizer optimizer = makeOptimizer();
     model->train();
 
-    size_t totalBatches = trainImageFiles.size();
-    for (size_t epoch = 1; epoch <= cfg.epochs; ++epoch) {
-        double epochLoss = 0.0;
-        size_t count = 0;
+    // Validation runs concurrently on a replica of the model
+    std::unique_ptr<AsyncValidator> validator;
+    if (!valImageFiles.empty()) {
+        validator = makeValidator([&](models::BaseModel& replica) {
+            return validate(replica, imgLoader, mskLoader);
+        });
+    }
 
-        for (auto& fname : trainImageFiles) {
-            auto imgT = imgLoader.loadCached(fname);
-            auto mskT = mskLoader.loadCached(fname);
-            if (!imgT.defined() || !mskT.defined()) {
-                std::cerr << "[WARN] Skipping " << fname << "\n";
-                continue;
+    size_t numSamples = trainImageFiles.size();
+
+    // Distillation: soft masks of the teacher at full size, computed once
+    cacheTeacherOutputs(numSamples, [&](size_t i) {
+        return imgLoader.loadCached(trainImageFiles[i]);
+    });
+
+    // Queue the samples of one micro-batch on the loader workers
+    // (position in the epoch's data order, file name, image, mask)
+    using Sample = std::tuple<size_t, std::string, torch::Tensor, torch::Tensor>;
+    auto fetchBatch = [&](size_t epoch, size_t batchIdx, const std::vector<int64_t>& order, cv::Size size) {
+        std::vector<std::future<Sample>> samples;
+        size_t first = batchIdx * cfg.batchSize;
+        size_t last = std::min(order.size(), first + cfg.batchSize);
+        for (size_t i = first; i < last; ++i) {
+            std::string fname = trainImageFiles[order[i]];
+            double fy = 0.5, fx = 0.5;
+            if (cfg.trainCrop > 0) {
+                // Window drawn from (epoch, position), so a resumed run crops the same windows
+                std::seed_seq seed{epoch, i};
+                std::mt19937 rng(seed);
+                std::uniform_real_distribution<double> unit(0.0, 1.0);
+                fy = unit(rng);
+                fx = unit(rng);
+            }
+            samples.push_back(loadAsync([this, &imgLoader, &mskLoader, i, fname, size, fy, fx] {
+                // An unreadable pair comes back undefined and is left out of the batch
+                try {
+                    if (cfg.trainCrop > 0) {
+                        auto [imgT, mskT] = loadCropPair(imgLoader, mskLoader, fname, cfg.trainCrop, fy, fx);
+                        return Sample(i, fname, imgT, mskT);
+                    }
+                    return Sample(i, fname, imgLoader.loadCached(fname, size), mskLoader.loadCached(fname, size));
+                } catch (const std::exception& e) { // includes a corrupt cache file (c10::Error)
+                    std::cerr << "[WARN] Training skips " << fname << ": " << e.what() << "\n";
+                    return Sample(i, fname, torch::Tensor(), torch::Tensor());
+                }
+            }));
+        }
+        return samples;
+    };
+
+    TrainingCursor cursor = beginTraining(optimizer, numSamples);
+    size_t windowSamples = 0; // samples used since the last optimizer step (checkpoints sit on step boundaries)
+    for (; cursor.epoch <= cfg.epochs; advanceEpoch(cursor, numSamples)) {
+        optimizer.zero_grad();
+        windowSamples = 0;
+        // Importance sampling may draw fewer samples than the dataset holds
+        size_t epochSamples = cursor.dataOrder.size();
+        size_t totalBatches = (epochSamples + cfg.batchSize - 1) / cfg.batchSize;
+        cv::Size size = epochSize(cursor.epoch); // unused with crops
+        if (!cfg.resizeSchedule.empty()) {
+            std::cout << "\n[INFO] Epoch " << cursor.epoch << ": training at " << size.width << "x" << size.height << "\n";
+        }
+        auto nextBatch = fetchBatch(cursor.epoch, cursor.batchIdx, cursor.dataOrder, size);
+        for (; cursor.batchIdx < totalBatches; ++cursor.batchIdx) {
+            // Gather one micro-batch of [C,H,W] samples; the next one loads meanwhile
+            auto batch = std::move(nextBatch);
+            if (cursor.batchIdx + 1 < totalBatches) {
+                nextBatch = fetchBatch(cursor.epoch, cursor.batchIdx + 1, cursor.dataOrder, size);
+            }
+            std::vector<torch::Tensor> imgs, msks;
+            std::vector<size_t> positions;
+            for (auto& sample : batch) {
+                auto [position, fname, imgT, mskT] = sample.get();
+                if (!imgT.defined() || !mskT.defined()) continue; // reported by the loader
+                imgs.push_back(imgT);
+                msks.push_back(mskT);
+                positions.push_back(position);
             }
 
-            // [C,H,W] -> [1,C,H,W]
-            auto input = imgT.unsqueeze(0).to(device);
-            auto target = mskT.unsqueeze(0).to(device);
+            torch::Tensor loss;
+            if (!imgs.empty()) {
+                // [B,C,H,W]
+                auto input = toInput(torch::stack(imgs));
+                auto target = torch::stack(msks).to(device);
 
-            auto output = model->predict(input);
+                auto output = model->predict(input);
 
-            // Weighted BCE
-            auto bce = torch::nn::functional::binary_cross_entropy_with_logits(
-                output, target, torch::nn::functional::BinaryCrossEntropyWithLogitsFuncOptions().pos_weight(torch::tensor(cfg.bcePosWeight).to(device))
-            );
-            // Dice
-            auto dice = med::loss::diceLoss(output, target);
+                // Weighted BCE + per-sample Dice, fused (single sigmoid, single pass)
+                auto perSample = med::loss::bceDiceLossPerSample(output, target, cfg.bcePosWeight);
+                perSample = distill(perSample, output, cursor, positions);
+                updateSampleLosses(cursor, positions, perSample);
+                loss = sampledMean(perSample, cursor, positions);
 
-            optimizer.zero_grad();
-            (bce + dice).backward();
-            optimizer.step();
+                // Sum over the used samples; stepAccumulated() divides by the window's total
+                (loss * static_cast<double>(imgs.size())).backward();
+                windowSamples += imgs.size();
+            }
 
-            epochLoss += (bce.item<double>() + dice.item<double>());
-            ++count;
+            // Loss stays on the device; the progress bar is drawn by the reporter thread
+            recordStep(loss, cursor, totalBatches);
 
-            // Print a live progress bar
-            printProgress(count, totalBatches);
-            std::cout << "  Epoch " << epoch << "/" << cfg.epochs
-                      << ", Batch " << count << "/" << totalBatches
-                      << ", AvgLoss=" << (epochLoss / std::max<size_t>(1, count)) << "\r";
+            if (isStepBoundary(cursor.batchIdx, totalBatches) && stepAccumulated(optimizer, windowSamples)) {
+                afterOptimizerStep(optimizer, cursor);
+            }
         }
-        std::cout << "\n";  // newline after each epoch
+        finishEpoch(cursor);
+        if (validator && validateEpoch(*validator, cursor)) break;
+    }
+    if (validator) finishValidation(*validator);
+    endTraining();
+}
+
+ValidationResult SegmentationTrainer::validate(models::BaseModel& replica,
+                                               data::ImageLoader& imgLoader,
+                                               data::ImageLoader& mskLoader) const {
+    double lossSum = 0.0, diceSum = 0.0;
+    size_t count = 0;
+    for (size_t first = 0; first < valImageFiles.size(); first += cfg.batchSize) {
+        std::vector<torch::Tensor> imgs, msks;
+        size_t last = std::min(valImageFiles.size(), first + cfg.batchSize);
+        for (size_t i = first; i < last; ++i) {
+            // An unreadable pair is left out of the scores, as in training
+            torch::Tensor imgT, mskT;
+            try {
+                if (cfg.trainCrop > 0) {
+                    // Centre window at native resolution, the scale the model trains at
+                    std::tie(imgT, mskT) = loadCropPair(imgLoader, mskLoader, valImageFiles[i], cfg.trainCrop, 0.5, 0.5);
+                } else {
+                    imgT = imgLoader.loadCached(valImageFiles[i]);
+                    mskT = mskLoader.loadCached(valImageFiles[i]);
+                }
+            } catch (const std::exception& e) { // includes a corrupt cache file (c10::Error)
+                std::cerr << "[WARN] Validation skips " << valImageFiles[i] << ": " << e.what() << "\n";
+            }
+            if (!imgT.defined() || !mskT.defined()) continue;
+            imgs.push_back(imgT);
+            msks.push_back(mskT);
+        }
+        if (imgs.empty()) continue;
+
+        auto input = toInput(torch::stack(imgs));
+        auto target = torch::stack(msks).to(device);
+        auto logits = replica.predict(input);
+
+        lossSum += med::loss::bceDiceLossPerSample(logits, target, cfg.bcePosWeight).sum().item<double>();
+
+        // Hard Dice of the thresholded prediction, per sample
+        auto pred = (logits >= 0).to(torch::kFloat).flatten(1);
+        auto gt = (target >= 0.5).to(torch::kFloat).flatten(1);
+        auto dice = (2.0 * (pred * gt).sum(1) + 1e-6) / (pred.sum(1) + gt.sum(1) + 1e-6);
+        diceSum += dice.sum().item<double>();
+        count += imgs.size();
     }
+
+    ValidationResult result;
+    result.scoreName = "Dice";
+    result.loss = lossSum / std::max<size_t>(1, count);
+    result.score = diceSum / std::max<size_t>(1, count);
+    return result;
+}
+
+void SegmentationTrainer::calibrate(size_t numSamples) {
+    data::ImageLoader imgLoader(cfg.segTrainDir + "/image", fullSize());
+    runCalibration(trainImageFiles.size(), numSamples, [&](size_t i) {
+        if (cfg.trainCrop > 0) return cropWindow(imgLoader.loadNative(trainImageFiles[i]), cfg.trainCrop, 0.5, 0.5);
+        return imgLoader.loadCached(trainImageFiles[i]);
+    });
 }
 
 void SegmentationTrainer::evaluate() {
@@ -104,12 +264,12 @@ void SegmentationTrainer::evaluate() {
         return;
     }
 
-    data::ImageLoader imgLoader(cfg.segTestDir + "/image", cv::Size(256,256));
-    data::ImageLoader mskLoader(cfg.segTestDir + "/mask",  cv::Size(256,256));
+    data::ImageLoader imgLoader(cfg.segTestDir + "/image", fullSize());
+    data::ImageLoader mskLoader(cfg.segTestDir + "/mask",  fullSize());
     eval::Benchmark bench;
 
     model->eval();
-    torch::NoGradGuard no_grad;
+    torch::InferenceMode inferenceMode;
 
     double sumAcc = 0, sumPrec = 0, sumRec = 0, sumF1 = 0, sumIoU = 0, sumMAE = 0, sumHD = 0;
     size_t testCount = 0;
@@ -118,9 +278,11 @@ void SegmentationTrainer::evaluate() {
     cv::VideoWriter writer;
     if (cfg.makeVideo) {
         int labelH = 50;
-        cv::Size targetSz(256,256);
+        cv::Size targetSz = fullSize();
         int demoW = targetSz.width * 3;
         int demoH = targetSz.height + labelH;
+        // Encoder threads spawned by open() inherit the video cores
+        common::ScopedAffinity videoCores(common::ThreadRole::Video);
         writer.open(
             cfg.modelName + "_demo.mp4",
             cv::VideoWriter::fourcc('m','p','4','v'),
@@ -132,28 +294,63 @@ void SegmentationTrainer::evaluate() {
         }
     }
 
-    for (auto& fname : testImageFiles) {
-        auto imgT = imgLoader.loadCached(fname);
-        auto mskRaw = mskLoader.loadRaw(fname); // raw cv::Mat mask (unprocessed)
-
-        if (!imgT.defined()) 
-            continue;
-        auto input = imgT.unsqueeze(0).to(device);
-
-        auto logits = model->predict(input);
-        auto prob = torch::sigmoid(logits).squeeze();
-        auto pred = (prob >= 0.5).to(torch::kU8);
-
-        // Convert to cv::Mat
-        auto cpuPred = pred.cpu();
-        cv::Mat predMat = imgLoader.tensorToMat(cpuPred);
+    const bool tiled = cfg.tileSize > 0;
+    std::unique_ptr<eval::TiledPredictor> tiler;
+    std::once_flag scaleWarning;
+    if (tiled) {
+        // Tiled inference at native resolution: the mask matches the ground truth pixel
+        // for pixel; the tiles of one image are batched. Tiles match the scale of a model
+        // trained with --train-crop; one trained on whole images resized to fullSize() saw
+        // structures smaller than native tiles show them.
+        tiler = std::make_unique<eval::TiledPredictor>(*model, device, cfg.tileSize, cfg.tileStride, cfg.tileBlend,
+            cfg.evalBatchSize, cfg.channelsLast ? torch::MemoryFormat::ChannelsLast : torch::MemoryFormat::Contiguous,
+            cfg.ttaViews);
+    }
 
-        // Load ground truth mask
-        if (mskRaw.empty()) {
-            std::cerr << "[WARN] No ground truth mask for " << fname << ", skipping metrics.\n";
-            continue;
+    // One test image on its way through the stages; each file is decoded exactly once
+    struct Item {
+        std::string name;
+        torch::Tensor input; // model input at fullSize() (whole-image path)
+        cv::Mat gray;        // native-resolution grayscale (tiled path)
+        cv::Mat original;    // decoded image, kept for the demo video
+        cv::Mat gtMask;      // ground truth as stored
+        cv::Mat predMat;     // predicted mask (0/255), set by the inference stage
+    };
+    auto decode = [&](const std::string& fname) {
+        Item item;
+        item.name = fname;
+        if (tiled || cfg.makeVideo) {
+            cv::Mat raw = imgLoader.loadRaw(fname);
+            if (tiled) {
+                cv::cvtColor(raw, item.gray, cv::COLOR_BGR2GRAY);
+                cv::Size full = fullSize();
+                double scale = std::max(double(raw.cols) / full.width, double(raw.rows) / full.height);
+                if (cfg.trainCrop == 0 && scale > 1.5) {
+                    std::call_once(scaleWarning, [&] {
+                        std::cerr << "[WARN] Tiles run at native resolution, about " << scale << "x the scale of the "
+                                  << full.width << "x" << full.height << " training images; expect degraded masks "
+                                  << "unless the model was trained with --train-crop\n";
+                    });
+                }
+            } else {
+                item.input = imgLoader.process(raw);
+            }
+            if (cfg.makeVideo) item.original = raw;
+        } else {
+            item.input = imgLoader.loadCached(fname);
+        }
+        item.gtMask = mskLoader.loadRaw(fname); // raw cv::Mat mask (unprocessed)
+        return item;
+    };
+
+    // Metrics of one prediction; leaves 8-bit single-channel masks in the item for the video
+    auto score = [&](Item& item) {
+        cv::Mat& gtMask = item.gtMask;
+        cv::Mat& predMat = item.predMat;
+        if (gtMask.empty()) {
+            std::cerr << "[WARN] No ground truth mask for " << item.name << ", skipping metrics.\n";
+            return false;
         }
-        cv::Mat gtMask = mskRaw;
         cv::resize(predMat, predMat, gtMask.size(), 0, 0, cv::INTER_NEAREST);
         if (predMat.channels() > 1) 
             cv::cvtColor(predMat, predMat, cv::COLOR_BGR2GRAY);
@@ -164,7 +361,6 @@ void SegmentationTrainer::evaluate() {
         if (gtMask.depth() != CV_8U)  
             gtMask.convertTo(gtMask, CV_8U, 255);
 
-        // Metrics
         sumAcc += bench.computeAccuracyPixels (predMat, gtMask);
         sumPrec += bench.computePrecisionPixels (predMat, gtMask);
         sumRec += bench.computeRecallPixels (predMat, gtMask);
@@ -173,23 +369,117 @@ void SegmentationTrainer::evaluate() {
         sumMAE += bench.computeMAE (predMat, gtMask);
         sumHD += bench.computeHausdorff (predMat, gtMask);
         ++testCount;
+        return true;
+    };
+
+    // Demo frame (Original | GT | Pred)
+    auto writeFrame = [&](Item& item) {
+        cv::Mat original;
+        cv::resize(item.original, original, fullSize(), 0, 0, cv::INTER_LINEAR);
+
+        cv::Mat gtResized, predResized;
+        cv::resize(item.gtMask, gtResized, fullSize(), 0,0, cv::INTER_NEAREST);
+        cv::resize(item.predMat, predResized, fullSize(), 0,0, cv::INTER_NEAREST);
+
+        cv::Mat predColor, gtColor;
+        cv::cvtColor(predResized, predColor, cv::COLOR_GRAY2BGR);
+        cv::cvtColor(gtResized, gtColor, cv::COLOR_GRAY2BGR);
+
+        common::Visualizer::writeSegmentationFrame(writer, original, gtColor, predColor, 50, cfg.holdFrames);
+    };
+
+    // Pipeline: decode (loader workers, or the producer thread without them) -> inference
+    // (this thread) -> metrics -> video.
+    // Bounded queues between the stages keep every stage busy with a few items in
+    // flight, so throughput is set by the slowest stage instead of the sum of all.
+    const size_t depth = 2 * cfg.evalBatchSize;
+    common::BoundedQueue<std::shared_future<Item>> decoded(depth);
+    common::BoundedQueue<Item> predicted(depth);
+    common::BoundedQueue<Item> frames(depth);
+    std::exception_ptr failure;
+    std::mutex failureMtx;
+    auto fail = [&](std::exception_ptr e) {
+        {
+            std::lock_guard<std::mutex> lock(failureMtx);
+            if (!failure) failure = e;
+        }
+        decoded.close();
+        predicted.close();
+        frames.close();
+    };
+
+    std::thread producer([&] {
+        common::Runtime::pinCurrentThread(common::ThreadRole::Loader);
+        for (const auto& fname : testImageFiles) {
+            auto item = loadEager([&decode, fname] { return decode(fname); }).share();
+            if (!decoded.push(item)) {
+                item.wait(); // the job references this frame; let it finish
+                break;
+            }
+        }
+        decoded.close();
+    });
 
-        // Build a demo frame (Original | GT | Pred)
-        if (cfg.makeVideo) {
-            cv::Mat original = imgLoader.loadRaw(fname);
-            cv::resize(original, original, cv::Size(256,256), 0, 0, cv::INTER_LINEAR);
-
-            cv::Mat gtResized, predResized;
-            cv::resize(gtMask, gtResized, cv::Size(256,256), 0,0, cv::INTER_NEAREST);
-            cv::resize(predMat, predResized, cv::Size(256,256), 0,0, cv::INTER_NEAREST);
-
-            cv::Mat predColor, gtColor;
-            cv::cvtColor(predResized, predColor, cv::COLOR_GRAY2BGR);
-            cv::cvtColor(gtResized, gtColor, cv::COLOR_GRAY2BGR);
-
-            common::Visualizer::writeSegmentationFrame(writer, original, gtColor, predColor, 50, cfg.holdFrames);
+    std::thread metricsStage([&] {
+        try {
+            while (auto item = predicted.pop()) {
+                if (score(*item) && cfg.makeVideo && !frames.push(std::move(*item))) break;
+            }
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        frames.close();
+    });
+
+    std::thread videoStage([&] {
+        common::Runtime::pinCurrentThread(common::ThreadRole::Video);
+        try {
+            while (auto item = frames.pop()) writeFrame(*item);
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    // Inference stage: one forward pass and one device-to-host copy per batch
+    try {
+        std::vector<Item> batch;
+        auto runBatch = [&] {
+            if (batch.empty()) return true;
+            std::vector<torch::Tensor> imgs;
+            for (const auto& item : batch) imgs.push_back(item.input);
+            // sigmoid(x) >= 0.5  <=>  x >= 0; TTA views share the forward pass
+            auto logits = eval::TestTimeAugmentation::predict(*model, toInput(torch::stack(imgs)), cfg.ttaViews);
+            auto preds = (logits >= 0).to(torch::kU8).squeeze(1).cpu(); // [B,H,W]
+            bool open = true;
+            for (size_t b = 0; b < batch.size() && open; ++b) {
+                batch[b].predMat = imgLoader.tensorToMat(preds[b]);
+                open = predicted.push(std::move(batch[b]));
+            }
+            batch.clear();
+            return open;
+        };
+        while (auto next = decoded.pop()) {
+            Item item = next->get();
+            if (tiled) {
+                item.predMat = tiler->predictMask(item.gray);
+                if (!predicted.push(std::move(item))) break;
+                continue;
+            }
+            if (!item.input.defined()) continue;
+            batch.push_back(std::move(item));
+            if (batch.size() == cfg.evalBatchSize && !runBatch()) break;
         }
+        runBatch();
+    } catch (...) {
+        fail(std::current_exception());
     }
+    predicted.close();
+    producer.join();
+    metricsStage.join();
+    videoStage.join();
+    // After a failure, decode jobs may still be queued on the loader workers
+    while (auto next = decoded.pop()) next->wait();
+    if (failure) std::rethrow_exception(failure);
 
     if (testCount > 0) {
         std::cout << "\n=== Test results over " << testCount << " images ===\n"
@@ -200,6 +490,7 @@ void SegmentationTrainer::evaluate() {
                   << "IoU      : " << (sumIoU / testCount) << "\n"
                   << "MAE      : " << (sumMAE / testCount) << "\n"
                   << "Hausdorff: " << (sumHD / testCount) << "\n\n";
+        lastTestScore = sumF1 / testCount; // F1 of binary masks = Dice
     }
 
     if (cfg.makeVideo) {
@@ -23,13 +23,20 @@ public:
     // Evaluate on cfg_.segTestDir and optionally write a demo video
     void evaluate() override;
 
+    // Forward a sample of the train split (int8 calibration)
+    void calibrate(size_t numSamples) override;
+
 private:
     // Load dataset filenames (pair of <image_filename, mask_filename>) for train/test
     std::vector<std::string> trainImageFiles;
+    std::vector<std::string> valImageFiles;   // held out of trainImageFiles (--val-split)
     std::vector<std::string> testImageFiles;
 
     // Helpers
     void loadFileLists();   // populate trainImageFiles_ and testImageFiles_
+
+    // Validation pass on valImageFiles (runs on the validator thread): loss and mean Dice
+    ValidationResult validate(models::BaseModel& replica, data::ImageLoader& imgLoader, data::ImageLoader& mskLoader) const;
 };
 
 } // namespace trainer